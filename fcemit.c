@@ -0,0 +1,271 @@
+/*
+TrueType to Adafruit_GFX font converter library.
+
+Output format emitters, see libfontconvert.h.
+*/
+
+#include <string.h>
+
+#include "libfontconvert.h"
+
+#define CHECK(expr) do { int err_ = (expr); if (err_ != FC_OK) return err_; } while (0)
+
+/* ---------------------------------------------------------------------- */
+/* C header */
+
+static int emit_header(const fc_font* font, const fc_options* opts, fc_sink* out) {
+	int i, j, x;
+	uint32_t k;
+	uint32_t char_;
+	const char* glyphName;
+	const char* declSpec = opts->progmem ? " PROGMEM" : "";
+	int use_compact = opts->compact;
+	int ranges16;
+	GFXglyphLayout layout;
+	uint8_t record[8];
+
+	// Print header
+	CHECK(fc_sink_printf(out, "/*******************************************************************\n"));
+	CHECK(fc_sink_printf(out, " *  Generated by fontconvert utility:\n"));
+	CHECK(fc_sink_printf(out, " * Font Name: '%s', filepath: '%s'\n", font->familyName, font->filePath));
+	CHECK(fc_sink_printf(out, " * Size: %dpt\n", font->size));
+	CHECK(fc_sink_printf(out, " * DPI: %d\n", font->dpi));
+	CHECK(fc_sink_printf(out, " * Hinting: %s\n",
+						 font->hinting == FC_HINTING_NO ? "no" : (font->hinting == FC_HINTING_AUTO ? "auto" : "mono")));
+	CHECK(fc_sink_printf(out, "Characters set ranges:\n"));
+	j = 0;
+	for (i = 0; i < font->rangesCount; i++) {
+		const char* firstName = font->glyphNames[j];
+		j += font->ranges[i].last - font->ranges[i].first + 1;
+		const char* lastName = font->glyphNames[j - 1];
+		CHECK(fc_sink_printf(out, "  %d: 0x%04X - 0x%04X ('%s' - '%s')\n", i,
+							 font->ranges[i].first, font->ranges[i].last,
+							 firstName[0] ? firstName : "unknown", lastName[0] ? lastName : "unknown"));
+	}
+	CHECK(fc_sink_printf(out, " *******************************************************************/\n"));
+	CHECK(fc_sink_printf(out, "\n"));
+
+	// Output huge bitmap data array
+	CHECK(fc_sink_printf(out, "const uint8_t %s_Bitmaps[]%s = {\n  ", font->fontName, declSpec));
+	for (k = 0; k < font->bitmapSize; k++) {
+		if (k > 0)
+			CHECK(fc_sink_printf(out, k % 12 ? ", " : ",\n  "));	// Format output table nicely
+		CHECK(fc_sink_printf(out, "0x%02X", font->bitmap[k]));
+	}
+	CHECK(fc_sink_printf(out, " };\n\n")); // End bitmap array
+
+	// Output glyph attributes table (one per character)
+	if (use_compact) {
+		fc_calc_compact_layout(&layout, font->glyphs, font->charsCount);
+		CHECK(fc_sink_printf(out, "const uint8_t %s_Glyphs[]%s = {\n", font->fontName, declSpec));
+	} else
+		CHECK(fc_sink_printf(out, "const GFXglyph %s_Glyphs[]%s = {\n", font->fontName, declSpec));
+	j = 0;
+	for (i = 0; i < font->rangesCount; i++) {
+		for (char_ = font->ranges[i].first; char_ <= font->ranges[i].last; char_++, j++) {
+			const GFXglyph* glyph = &font->glyphs[j];
+			if (use_compact) {
+				fc_pack_compact_glyph(record, glyph, &layout);
+				CHECK(fc_sink_printf(out, "  "));
+				for (x = 0; x < layout.recordSize; x++)
+					CHECK(fc_sink_printf(out, x ? ", 0x%02X" : "0x%02X", record[x]));
+			} else {
+				CHECK(fc_sink_printf(out, "  { %5d, %3d, %3d, %3d, %4d, %4d }", glyph->bitmapOffset,
+									 glyph->width, glyph->height, glyph->xAdvance, glyph->xOffset,
+									 glyph->yOffset));
+			}
+			glyphName = font->glyphNames[j];
+			if (i == font->rangesCount - 1 && char_ == font->ranges[i].last)
+				CHECK(fc_sink_printf(out, " }; // 0x%02X", (unsigned int)char_));
+			else
+				CHECK(fc_sink_printf(out, ",   // 0x%02X", (unsigned int)char_));
+			if (glyphName[0])
+				CHECK(fc_sink_printf(out, " '%s'", glyphName));
+			CHECK(fc_sink_printf(out, "\n"));
+		}
+	}
+	CHECK(fc_sink_printf(out, "\n"));
+
+	// Output characters set range list. In compact mode as little-endian
+	// byte array, 16-bit pairs if possible
+	ranges16 = use_compact && fc_ranges16(font);
+	if (use_compact) {
+		int rangeSize = ranges16 ? 2 : 4;
+		CHECK(fc_sink_printf(out, "const uint8_t %s_Ranges[]%s = {\n", font->fontName, declSpec));
+		for (i = 0; i < font->rangesCount; i++) {
+			uint32_t values[2] = { font->ranges[i].first, font->ranges[i].last };
+			CHECK(fc_sink_printf(out, "  "));
+			for (x = 0; x < 2 * rangeSize; x++)
+				CHECK(fc_sink_printf(out, x ? ", 0x%02X" : "0x%02X",
+									 (unsigned int)((values[x / rangeSize] >> (8 * (x % rangeSize))) & 0xFF)));
+			if (i == font->rangesCount - 1)
+				CHECK(fc_sink_printf(out, " }; // 0x%04X - 0x%04X\n", values[0], values[1]));
+			else
+				CHECK(fc_sink_printf(out, ",   // 0x%04X - 0x%04X\n", values[0], values[1]));
+		}
+	} else {
+		CHECK(fc_sink_printf(out, "const GFXglyphRange %s_Ranges[]%s = {\n", font->fontName, declSpec));
+		for (i = 0; i < font->rangesCount - 1; i++) {
+			CHECK(fc_sink_printf(out, "  { 0x%04X, 0x%04X },\n", font->ranges[i].first, font->ranges[i].last));
+		}
+		CHECK(fc_sink_printf(out, "  { 0x%04X, 0x%04X } };\n", font->ranges[font->rangesCount - 1].first,
+							 font->ranges[font->rangesCount - 1].last));
+	}
+	CHECK(fc_sink_printf(out, "\n"));
+
+	// Output font structure
+	CHECK(fc_sink_printf(out, "const %s %s%s = {\n", use_compact ? "GFXfontCompact" : "GFXfont",
+						 font->fontName, declSpec));
+	CHECK(fc_sink_printf(out, "  %s_Bitmaps,\n", font->fontName));
+	CHECK(fc_sink_printf(out, "  %s_Glyphs,\n", font->fontName));
+	CHECK(fc_sink_printf(out, "  %s_Ranges, %d,\n", font->fontName, font->rangesCount));
+	if (use_compact)
+		CHECK(fc_sink_printf(out, "  %s,		// flags\n", ranges16 ? "GFX_COMPACT_RANGES16" : "0"));
+	CHECK(fc_sink_printf(out, "  %d,		// characters count\n", font->charsCount));
+	CHECK(fc_sink_printf(out, "  %d,		// newline distance in pixels\n", font->yAdvance));
+	if (use_compact) {
+		CHECK(fc_sink_printf(out, "  %u,		// bitmap size\n", font->bitmapSize));
+		CHECK(fc_sink_printf(out, "  { %d, %d, %d, %d, %d, %d, %d, %d, %d } };	// glyph record layout\n\n",
+							 layout.offsetBits, layout.widthBits, layout.heightBits, layout.xAdvanceBits,
+							 layout.xOffsetBits, layout.yOffsetBits, layout.xOffsetBias, layout.yOffsetBias,
+							 layout.recordSize));
+		CHECK(fc_sink_printf(out, "// Approx. %u bytes\n", (unsigned int)(font->bitmapSize + font->charsCount*layout.recordSize +
+							 font->rangesCount*(ranges16 ? 4 : 8) + sizeof(GFXfontCompact))));
+	} else {
+		CHECK(fc_sink_printf(out, "  %u };	// bitmap size\n\n", font->bitmapSize));
+		CHECK(fc_sink_printf(out, "// Approx. %u bytes\n", (unsigned int)(font->bitmapSize + font->charsCount*sizeof(GFXglyph) +
+							 font->rangesCount*sizeof(GFXglyphRange) + sizeof(GFXfont))));
+	}
+	return FC_OK;
+}
+
+const fc_emitter fc_emitter_header = { "header", emit_header };
+
+/* ---------------------------------------------------------------------- */
+/* Binary blob */
+
+static void put_le(uint8_t* dst, uint32_t value, int size) {
+	int i;
+	for (i = 0; i < size; i++) {
+		dst[i] = (uint8_t)(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+static void binary_glyph_layout(const fc_font* font, int compact, GFXglyphLayout* layout) {
+	memset(layout, 0, sizeof(GFXglyphLayout));
+	if (compact)
+		fc_calc_compact_layout(layout, font->glyphs, font->charsCount);
+	else
+		layout->recordSize = 7;
+}
+
+static int write_binary_header(const fc_font* font, int compact, fc_sink* out) {
+	uint8_t header[FC_BINARY_HEADER_SIZE];
+	GFXglyphLayout layout;
+	int ranges16 = compact && fc_ranges16(font);
+
+	memset(header, 0, sizeof(header));
+	binary_glyph_layout(font, compact, &layout);
+	memcpy(header, "GFXF", 4);
+	header[4] = FC_BINARY_VERSION;
+	header[5] = (compact ? FC_BINARY_COMPACT : 0) | (ranges16 ? FC_BINARY_RANGES16 : 0);
+	put_le(header + 6, font->rangesCount, 2);
+	put_le(header + 8, font->charsCount, 2);
+	header[10] = (uint8_t)font->yAdvance;
+	header[11] = layout.recordSize;
+	put_le(header + 12, font->bitmapSize, 4);
+	if (compact) {
+		header[16] = layout.offsetBits;
+		header[17] = layout.widthBits;
+		header[18] = layout.heightBits;
+		header[19] = layout.xAdvanceBits;
+		header[20] = layout.xOffsetBits;
+		header[21] = layout.yOffsetBits;
+		header[22] = (uint8_t)layout.xOffsetBias;
+		header[23] = (uint8_t)layout.yOffsetBias;
+		header[24] = layout.recordSize;
+	}
+	return fc_sink_write(out, header, sizeof(header));
+}
+
+static int write_binary_ranges(const fc_font* font, int compact, fc_sink* out) {
+	uint8_t record[8];
+	int rangeSize = compact && fc_ranges16(font) ? 2 : 4;
+	int i;
+
+	for (i = 0; i < font->rangesCount; i++) {
+		put_le(record, font->ranges[i].first, rangeSize);
+		put_le(record + rangeSize, font->ranges[i].last, rangeSize);
+		CHECK(fc_sink_write(out, record, 2 * rangeSize));
+	}
+	return FC_OK;
+}
+
+static int write_binary_glyphs(const fc_font* font, int compact, fc_sink* out) {
+	uint8_t record[8];
+	GFXglyphLayout layout;
+	int i;
+
+	binary_glyph_layout(font, compact, &layout);
+	for (i = 0; i < font->charsCount; i++) {
+		const GFXglyph* glyph = &font->glyphs[i];
+		if (compact) {
+			fc_pack_compact_glyph(record, glyph, &layout);
+		} else {
+			put_le(record, glyph->bitmapOffset, 2);
+			record[2] = glyph->width;
+			record[3] = glyph->height;
+			record[4] = glyph->xAdvance;
+			record[5] = (uint8_t)glyph->xOffset;
+			record[6] = (uint8_t)glyph->yOffset;
+		}
+		CHECK(fc_sink_write(out, record, layout.recordSize));
+	}
+	return FC_OK;
+}
+
+int fc_binary_section(const fc_font* font, int compact, int section, fc_sink* out) {
+	switch (section) {
+		case FC_SECTION_HEADER:
+			return write_binary_header(font, compact, out);
+		case FC_SECTION_RANGES:
+			return write_binary_ranges(font, compact, out);
+		case FC_SECTION_GLYPHS:
+			return write_binary_glyphs(font, compact, out);
+		case FC_SECTION_BITMAP:
+			return fc_sink_write(out, font->bitmap, font->bitmapSize);
+		default:
+			return FC_ERR_ARGS;
+	}
+}
+
+static int emit_binary(const fc_font* font, const fc_options* opts, fc_sink* out) {
+	int section;
+	for (section = 0; section < FC_SECTIONS_COUNT; section++)
+		CHECK(fc_binary_section(font, opts->compact, section, out));
+	return FC_OK;
+}
+
+const fc_emitter fc_emitter_binary = { "binary", emit_binary };
+
+/* ---------------------------------------------------------------------- */
+
+static const fc_emitter* builtin_emitters[] = {
+	&fc_emitter_header,
+	&fc_emitter_binary,
+	0
+};
+
+const fc_emitter* fc_find_emitter(const char* name) {
+	int i;
+	for (i = 0; builtin_emitters[i]; i++) {
+		if (strcmp(builtin_emitters[i]->name, name) == 0)
+			return builtin_emitters[i];
+	}
+	return 0;
+}
+
+int fc_emit(const fc_emitter* emitter, const fc_font* font, const fc_options* opts, fc_sink* out) {
+	return emitter->emit(font, opts, out);
+}
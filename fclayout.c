@@ -0,0 +1,454 @@
+/*
+TrueType to Adafruit_GFX font converter library.
+
+Stable glyph placement using layout manifest of previous build and
+binary patches between builds, see libfontconvert.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libfontconvert.h"
+
+#define MAX_LINE_LEN		256
+// Regions separated by smaller gap are merged (region header is 9 bytes)
+#define PATCH_MERGE_GAP		9
+
+#define CHECK(expr) do { int err_ = (expr); if (err_ != FC_OK) return err_; } while (0)
+
+static uint32_t crc32(const uint8_t* data, uint32_t size) {
+	uint32_t crc = 0xFFFFFFFF;
+	uint32_t i;
+	int k;
+	for (i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+static uint32_t glyph_bitmap_size(const GFXglyph* glyph) {
+	return ((uint32_t)glyph->width * glyph->height + 7) / 8;
+}
+
+// Bitmap space occupied by a glyph slot or free for placement
+typedef struct {
+	uint32_t offset;
+	uint32_t size;
+} slot_span;
+
+static int compare_spans(const void* a, const void* b) {
+	const slot_span* x = (const slot_span*)a;
+	const slot_span* y = (const slot_span*)b;
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+// Sort non-empty slots by offset, returns their count or -1 if any two overlap
+static int sort_slots(slot_span* spans, int count) {
+	int i, n = 0;
+	for (i = 0; i < count; i++) {
+		if (spans[i].size)
+			spans[n++] = spans[i];
+	}
+	qsort(spans, n, sizeof(slot_span), compare_spans);
+	for (i = 1; i < n; i++) {
+		if (spans[i - 1].offset + spans[i - 1].size > spans[i].offset)
+			return -1;
+	}
+	return n;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Layout manifest */
+
+int fc_layout_write(const fc_font* font, const fc_options* opts, fc_sink* out) {
+	int i, j;
+	uint32_t char_;
+
+	CHECK(fc_sink_printf(out, "# fontconvert layout manifest\n"));
+	CHECK(fc_sink_printf(out, "font %u %d %d\n", font->bitmapSize, font->yAdvance, opts->compact ? 1 : 0));
+	for (i = 0; i < font->rangesCount; i++)
+		CHECK(fc_sink_printf(out, "range 0x%04X 0x%04X\n", font->ranges[i].first, font->ranges[i].last));
+	j = 0;
+	for (i = 0; i < font->rangesCount; i++) {
+		for (char_ = font->ranges[i].first; char_ <= font->ranges[i].last; char_++, j++) {
+			const GFXglyph* glyph = &font->glyphs[j];
+			CHECK(fc_sink_printf(out, "glyph 0x%04X %u %u %u %u %u %d %d %08X\n", (unsigned int)char_,
+								 glyph->bitmapOffset, font->slotSizes[j], glyph->width, glyph->height,
+								 glyph->xAdvance, glyph->xOffset, glyph->yOffset,
+								 crc32(font->bitmap + glyph->bitmapOffset, glyph_bitmap_size(glyph))));
+		}
+	}
+	return FC_OK;
+}
+
+// Check that glyphs match ranges and their slots fit bitmap without overlapping
+static int validate_layout(const fc_layout* layout) {
+	slot_span* spans;
+	uint32_t char_;
+	int i, j;
+	int res;
+
+	j = 0;
+	for (i = 0; i < layout->rangesCount; i++) {
+		for (char_ = layout->ranges[i].first; char_ <= layout->ranges[i].last; char_++, j++) {
+			if (layout->codepoints[j] != char_)
+				return FC_ERR_LAYOUT;
+		}
+	}
+	if (!(spans = (slot_span*)malloc(layout->charsCount * sizeof(slot_span))))
+		return FC_ERR_NOMEM;
+	for (j = 0; j < layout->charsCount; j++) {
+		spans[j].offset = layout->glyphs[j].bitmapOffset;
+		spans[j].size = layout->slotSizes[j];
+		if (spans[j].size < glyph_bitmap_size(&layout->glyphs[j]) ||
+			spans[j].offset + spans[j].size > layout->bitmapSize)
+			break;
+	}
+	res = j < layout->charsCount || sort_slots(spans, layout->charsCount) < 0 ? FC_ERR_LAYOUT : FC_OK;
+	free(spans);
+	return res;
+}
+
+int fc_layout_read(fc_layout* layout, FILE* file) {
+	char line[MAX_LINE_LEN];
+	int capacity = 0;
+	int chars_count = 0;
+	int have_font = 0;
+	int err;
+	int i;
+
+	memset(layout, 0, sizeof(fc_layout));
+	while (fgets(line, MAX_LINE_LEN, file)) {
+		unsigned int bitmapSize, code, offset, slot, width, height, xAdvance, crc;
+		int yAdvance, compact, xOffset, yOffset;
+		unsigned int first, last;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "font %u %d %d", &bitmapSize, &yAdvance, &compact) == 3) {
+			if (bitmapSize > FC_MAX_BITMAP_SIZE || yAdvance < 0 || yAdvance > 0xFF ||
+				(compact != 0 && compact != 1))
+				goto error;
+			layout->bitmapSize = bitmapSize;
+			layout->yAdvance = yAdvance;
+			layout->compact = compact;
+			have_font = 1;
+		} else if (sscanf(line, "range %i %i", &first, &last) == 2) {
+			if (layout->rangesCount >= FC_MAX_RANGES || last < first || last > 0xFFFF ||
+				layout->charsCount > 0 ||
+				(layout->rangesCount > 0 && first <= layout->ranges[layout->rangesCount - 1].last))
+				goto error;
+			layout->ranges[layout->rangesCount].first = first;
+			layout->ranges[layout->rangesCount].last = last;
+			layout->rangesCount++;
+			chars_count += last - first + 1;
+		} else if (sscanf(line, "glyph %i %u %u %u %u %u %d %d %x", &code, &offset, &slot,
+						  &width, &height, &xAdvance, &xOffset, &yOffset, &crc) == 9) {
+			i = layout->charsCount;
+			if (i >= chars_count || offset > FC_MAX_BITMAP_SIZE || slot > FC_MAX_BITMAP_SIZE ||
+				width > 0xFF || height > 0xFF || xAdvance > 0xFF ||
+				xOffset < -128 || xOffset > 127 || yOffset < -128 || yOffset > 127)
+				goto error;
+			if (0 == capacity) {
+				capacity = chars_count;
+				if (!(layout->codepoints = (uint32_t*)malloc(capacity * sizeof(uint32_t))) ||
+					!(layout->glyphs = (GFXglyph*)malloc(capacity * sizeof(GFXglyph))) ||
+					!(layout->slotSizes = (uint16_t*)malloc(capacity * sizeof(uint16_t))) ||
+					!(layout->crcs = (uint32_t*)malloc(capacity * sizeof(uint32_t)))) {
+					fc_layout_free(layout);
+					return FC_ERR_NOMEM;
+				}
+			}
+			layout->codepoints[i] = code;
+			layout->glyphs[i].bitmapOffset = offset;
+			layout->glyphs[i].width = width;
+			layout->glyphs[i].height = height;
+			layout->glyphs[i].xAdvance = xAdvance;
+			layout->glyphs[i].xOffset = xOffset;
+			layout->glyphs[i].yOffset = yOffset;
+			layout->slotSizes[i] = slot;
+			layout->crcs[i] = crc;
+			layout->charsCount++;
+		} else
+			goto error;
+	}
+	if (!have_font || 0 == layout->rangesCount || layout->charsCount != chars_count)
+		goto error;
+	if ((err = validate_layout(layout)) != FC_OK) {
+		fc_layout_free(layout);
+		return err;
+	}
+	return FC_OK;
+
+error:
+	fc_layout_free(layout);
+	return FC_ERR_LAYOUT;
+}
+
+void fc_layout_free(fc_layout* layout) {
+	free(layout->codepoints);
+	free(layout->glyphs);
+	free(layout->slotSizes);
+	free(layout->crcs);
+	memset(layout, 0, sizeof(fc_layout));
+}
+
+int fc_layout_find(const fc_layout* layout, uint32_t code) {
+	int lo = 0;
+	int hi = layout->charsCount - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (layout->codepoints[mid] == code)
+			return mid;
+		if (layout->codepoints[mid] < code)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+int fc_layout_apply(const fc_layout* layout, fc_font* font, fc_arena* arena) {
+	int i, j, k;
+	int count;
+	int err = FC_OK;
+	uint32_t char_;
+	uint32_t size;
+	uint32_t end = 0;
+	uint16_t* offsets;
+	uint8_t* bitmap;
+	int* prevIndex;
+	slot_span* spans;
+	slot_span* gaps;
+	int gapsCount = 0;
+
+	if (!(offsets = (uint16_t*)fc_arena_alloc(arena, font->charsCount * sizeof(uint16_t))))
+		return FC_ERR_NOMEM;
+	prevIndex = (int*)malloc(font->charsCount * sizeof(int));
+	spans = (slot_span*)malloc((layout->charsCount + 1) * sizeof(slot_span));
+	gaps = (slot_span*)malloc((layout->charsCount + 1) * sizeof(slot_span));
+	if (!prevIndex || !spans || !gaps) {
+		err = FC_ERR_NOMEM;
+		goto done;
+	}
+
+	// Keep glyph in its previous slot while it fits
+	count = 0;
+	j = 0;
+	for (i = 0; i < font->rangesCount; i++) {
+		for (char_ = font->ranges[i].first; char_ <= font->ranges[i].last; char_++, j++) {
+			k = fc_layout_find(layout, char_);
+			if (k >= 0 && layout->slotSizes[k] < glyph_bitmap_size(&font->glyphs[j]))
+				k = -1;
+			prevIndex[j] = k;
+			if (k >= 0) {
+				offsets[j] = layout->glyphs[k].bitmapOffset;
+				font->slotSizes[j] = layout->slotSizes[k];
+				spans[count].offset = offsets[j];
+				spans[count++].size = font->slotSizes[j];
+				if (offsets[j] + (uint32_t)font->slotSizes[j] > end)
+					end = offsets[j] + (uint32_t)font->slotSizes[j];
+			}
+		}
+	}
+
+	// Free space: gaps between kept slots, including slots of removed
+	// or grown glyphs, and the rest of 64K after the last kept slot
+	count = sort_slots(spans, count);
+	size = 0;
+	for (i = 0; i < count; i++) {
+		if (spans[i].offset > size) {
+			gaps[gapsCount].offset = size;
+			gaps[gapsCount++].size = spans[i].offset - size;
+		}
+		size = spans[i].offset + spans[i].size;
+	}
+	gaps[gapsCount].offset = size;
+	gaps[gapsCount++].size = FC_MAX_BITMAP_SIZE - size;
+
+	// Place new and grown glyphs first-fit, bitmap ends at the last used byte
+	for (j = 0; j < font->charsCount; j++) {
+		if (prevIndex[j] >= 0)
+			continue;
+		size = glyph_bitmap_size(&font->glyphs[j]);
+		for (i = 0; i < gapsCount && gaps[i].size < size; i++)
+			;
+		if (i == gapsCount) {
+			err = FC_ERR_OVERFLOW;
+			goto done;
+		}
+		offsets[j] = (uint16_t)gaps[i].offset;
+		font->slotSizes[j] = (uint16_t)size;
+		gaps[i].offset += size;
+		gaps[i].size -= size;
+		if (gaps[i].offset > end)
+			end = gaps[i].offset;
+	}
+
+	if (!(bitmap = (uint8_t*)fc_arena_alloc(arena, end))) {
+		err = FC_ERR_NOMEM;
+		goto done;
+	}
+	for (j = 0; j < font->charsCount; j++) {
+		memcpy(bitmap + offsets[j], font->bitmap + font->glyphs[j].bitmapOffset,
+			   glyph_bitmap_size(&font->glyphs[j]));
+		font->glyphs[j].bitmapOffset = offsets[j];
+	}
+	font->bitmap = bitmap;
+	font->bitmapSize = end;
+
+done:
+	free(prevIndex);
+	free(spans);
+	free(gaps);
+	return err;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Patch */
+
+typedef struct {
+	fc_sink regions;
+	uint32_t regionsCount;
+} patch_state;
+
+static void put_le(uint8_t* dst, uint32_t value, int size) {
+	int i;
+	for (i = 0; i < size; i++) {
+		dst[i] = (uint8_t)(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+// Write regions of section covering all dirty bytes
+static int add_dirty_regions(patch_state* state, int section, const uint8_t* data,
+							 const uint8_t* dirty, uint32_t size) {
+	uint8_t header[9];
+	uint32_t start, end, pos;
+
+	pos = 0;
+	while (pos < size) {
+		if (!dirty[pos]) {
+			pos++;
+			continue;
+		}
+		start = pos;
+		end = pos + 1;
+		for (pos = end; pos < size && pos - end <= PATCH_MERGE_GAP; pos++) {
+			if (dirty[pos])
+				end = pos + 1;
+		}
+		pos = end;
+		header[0] = (uint8_t)section;
+		put_le(header + 1, start, 4);
+		put_le(header + 5, end - start, 4);
+		CHECK(fc_sink_write(&state->regions, header, sizeof(header)));
+		CHECK(fc_sink_write(&state->regions, data + start, end - start));
+		state->regionsCount++;
+	}
+	return FC_OK;
+}
+
+static int patch_sections(patch_state* state, const fc_layout* prev, const fc_font* font,
+						  const fc_options* opts, uint32_t* sizes, uint8_t* dirty, uint8_t* kept) {
+	fc_font old;
+	fc_sink oldSec;
+	fc_sink newSec;
+	uint32_t i;
+	uint32_t char_;
+	int r, j, k;
+	int section;
+	int err = FC_OK;
+
+	// Previous build tables are restored from the manifest
+	memset(&old, 0, sizeof(old));
+	old.ranges = prev->ranges;
+	old.rangesCount = prev->rangesCount;
+	old.glyphs = prev->glyphs;
+	old.charsCount = prev->charsCount;
+	old.yAdvance = prev->yAdvance;
+	old.bitmapSize = prev->bitmapSize;
+
+	fc_sink_init_memory(&oldSec, 0, 0);
+	fc_sink_init_memory(&newSec, 0, 0);
+	for (section = FC_SECTION_HEADER; section < FC_SECTION_BITMAP && err == FC_OK; section++) {
+		fc_sink_reset(&oldSec);
+		fc_sink_reset(&newSec);
+		if ((err = fc_binary_section(&old, prev->compact, section, &oldSec)) != FC_OK ||
+			(err = fc_binary_section(font, opts->compact, section, &newSec)) != FC_OK)
+			break;
+		sizes[section] = (uint32_t)newSec.size;
+		for (i = 0; i < newSec.size; i++)
+			dirty[i] = i >= oldSec.size || oldSec.buffer[i] != newSec.buffer[i];
+		err = add_dirty_regions(state, section, newSec.buffer, dirty, (uint32_t)newSec.size);
+	}
+	fc_sink_free(&oldSec);
+	fc_sink_free(&newSec);
+	if (err != FC_OK)
+		return err;
+
+	// Bitmap: only glyphs changed or moved since previous build. Whole slot
+	// is rewritten, so that patched bitmap is identical to the new one.
+	sizes[FC_SECTION_BITMAP] = font->bitmapSize;
+	memset(dirty, 0, font->bitmapSize);
+	memset(kept, 0, prev->charsCount);
+	j = 0;
+	for (r = 0; r < font->rangesCount; r++) {
+		for (char_ = font->ranges[r].first; char_ <= font->ranges[r].last; char_++, j++) {
+			const GFXglyph* glyph = &font->glyphs[j];
+			const uint8_t* data = font->bitmap + glyph->bitmapOffset;
+			uint32_t size = glyph_bitmap_size(glyph);
+			k = fc_layout_find(prev, char_);
+			if (k >= 0 && prev->glyphs[k].bitmapOffset == glyph->bitmapOffset) {
+				kept[k] = 1;
+				if (glyph_bitmap_size(&prev->glyphs[k]) == size && prev->crcs[k] == crc32(data, size))
+					continue;
+			}
+			memset(dirty + glyph->bitmapOffset, 1, font->slotSizes[j]);
+		}
+	}
+	// Clear slots left by removed or moved glyphs
+	for (k = 0; k < prev->charsCount; k++) {
+		if (!kept[k])
+			memset(dirty + prev->glyphs[k].bitmapOffset, 1, prev->slotSizes[k]);
+	}
+	return add_dirty_regions(state, FC_SECTION_BITMAP, font->bitmap, dirty, font->bitmapSize);
+}
+
+int fc_make_patch(const fc_layout* prev, const fc_font* font, const fc_options* opts, fc_sink* out) {
+	uint8_t header[28];
+	uint32_t sizes[FC_SECTIONS_COUNT];
+	uint8_t* dirty;
+	uint8_t* kept;
+	patch_state state;
+	int section;
+	int err;
+
+	// Dirty flags buffer is shared by all sections, glyph table is the largest one
+	size_t dirty_size = (size_t)font->charsCount * 8 + FC_MAX_BITMAP_SIZE + FC_BINARY_HEADER_SIZE;
+	if (!(dirty = (uint8_t*)malloc(dirty_size)))
+		return FC_ERR_NOMEM;
+	if (!(kept = (uint8_t*)malloc(prev->charsCount + 1))) {
+		free(dirty);
+		return FC_ERR_NOMEM;
+	}
+	memset(&state, 0, sizeof(state));
+	fc_sink_init_memory(&state.regions, 0, 0);
+	err = patch_sections(&state, prev, font, opts, sizes, dirty, kept);
+	free(kept);
+	free(dirty);
+
+	if (err == FC_OK) {
+		memset(header, 0, sizeof(header));
+		memcpy(header, "GFXP", 4);
+		header[4] = FC_PATCH_VERSION;
+		for (section = 0; section < FC_SECTIONS_COUNT; section++)
+			put_le(header + 8 + 4 * section, sizes[section], 4);
+		put_le(header + 24, state.regionsCount, 4);
+		if ((err = fc_sink_write(out, header, sizeof(header))) == FC_OK)
+			err = fc_sink_write(out, state.regions.buffer, state.regions.size);
+	}
+	fc_sink_free(&state.regions);
+	return err;
+}
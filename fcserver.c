@@ -0,0 +1,275 @@
+/*
+Local conversion daemon of the fontconvert utility, see fcserver.h.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "fcserver.h"
+
+#define MAX_REQUEST_ARGS	64
+#define MAX_CLIENTS			16
+#define CLIENT_IDLE_TIMEOUT	60		// seconds without data before connection is dropped
+#define CLIENT_IO_TIMEOUT	5		// seconds to send response
+#define POLL_INTERVAL_MS	1000
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void stop_handler(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+static int write_full(int fd, const void* buffer, size_t size) {
+	const uint8_t* ptr = (const uint8_t*)buffer;
+	while (size > 0) {
+		ssize_t res = write(fd, ptr, size);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			return 0;
+		ptr += res;
+		size -= (size_t)res;
+	}
+	return 1;
+}
+
+static void put_u32(uint8_t* dst, uint32_t value) {
+	dst[0] = (uint8_t)(value & 0xFF);
+	dst[1] = (uint8_t)((value >> 8) & 0xFF);
+	dst[2] = (uint8_t)((value >> 16) & 0xFF);
+	dst[3] = (uint8_t)((value >> 24) & 0xFF);
+}
+
+static uint32_t get_u32(const uint8_t* src) {
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static int send_response(int fd, int status, const fc_sink* out, const fc_sink* log) {
+	uint8_t header[12];
+	put_u32(header, (uint32_t)status);
+	put_u32(header + 4, (uint32_t)out->size);
+	put_u32(header + 8, (uint32_t)log->size);
+	return write_full(fd, header, sizeof(header)) &&
+		write_full(fd, out->buffer, out->size) &&
+		write_full(fd, log->buffer, log->size);
+}
+
+// Connection state: request being received
+typedef struct {
+	int      fd;
+	uint8_t* buffer;			// length prefix and payload
+	uint32_t received;
+	time_t   lastActive;
+} client_conn;
+
+static void close_client(client_conn* conn) {
+	close(conn->fd);
+	free(conn->buffer);
+	conn->fd = -1;
+	conn->buffer = 0;
+}
+
+// Run complete request of client, returns 0 if connection should be closed
+static int process_request(client_conn* conn, fc_request_handler handler, void* userdata,
+						   fc_sink* out, fc_sink* log) {
+	char* request = (char*)conn->buffer + 4;
+	uint32_t len = conn->received - 4;
+	char* argv[MAX_REQUEST_ARGS + 1];
+	uint32_t i;
+	int argc;
+	int status;
+
+	fc_sink_reset(out);
+	fc_sink_reset(log);
+	request[len] = 0;
+
+	// Split payload into arguments
+	argv[0] = "fontconvert";
+	argc = 1;
+	for (i = 0; i < len && argc < MAX_REQUEST_ARGS; argc++) {
+		argv[argc] = request + i;
+		i += (uint32_t)strlen(request + i) + 1;
+	}
+	argv[argc] = 0;
+	if (i < len) {
+		fc_sink_printf(log, "Too many arguments!\n");
+		status = 1;
+	} else
+		status = handler(userdata, argc, argv, out, log);
+	conn->received = 0;
+	return send_response(conn->fd, status, out, log);
+}
+
+// Read available part of request, returns 0 if connection should be closed
+static int receive_request(client_conn* conn, fc_request_handler handler, void* userdata,
+						   fc_sink* out, fc_sink* log) {
+	uint32_t need = conn->received < 4 ? 4 : 4 + get_u32(conn->buffer);
+	// Single read() does not block after poll(), the next request stays in socket buffer
+	ssize_t res = read(conn->fd, conn->buffer + conn->received, need - conn->received);
+
+	if (res < 0 && errno == EINTR)
+		return 1;
+	if (res <= 0)
+		return 0;
+	conn->received += (uint32_t)res;
+	conn->lastActive = time(0);
+	if (conn->received < 4)
+		return 1;
+	if (get_u32(conn->buffer) > FC_SERVE_MAX_REQUEST) {
+		fc_sink_reset(out);
+		fc_sink_reset(log);
+		fc_sink_printf(log, "Request too large!\n");
+		send_response(conn->fd, 1, out, log);
+		return 0;
+	}
+	if (conn->received == 4 + get_u32(conn->buffer))
+		return process_request(conn, handler, userdata, out, log);
+	return 1;
+}
+
+// Remove existing socket file left by previous instance, never other files
+static int remove_stale_socket(const char* socketPath) {
+	struct stat st;
+
+	if (lstat(socketPath, &st) < 0)
+		return errno == ENOENT ? 0 : -1;
+	if (!S_ISSOCK(st.st_mode)) {
+		errno = EEXIST;
+		return -1;
+	}
+	return unlink(socketPath);
+}
+
+static void accept_client(int fd, client_conn* clients) {
+	struct timeval timeout;
+	int client;
+	int i;
+
+	if ((client = accept(fd, 0, 0)) < 0) {
+		if (errno != EINTR && errno != EAGAIN)
+			perror("accept");
+		return;
+	}
+	for (i = 0; i < MAX_CLIENTS && clients[i].fd >= 0; i++)
+		;
+	if (i == MAX_CLIENTS || !(clients[i].buffer = (uint8_t*)malloc(4 + FC_SERVE_MAX_REQUEST + 1))) {
+		close(client);
+		return;
+	}
+	// Client not reading its response must not stall the daemon
+	timeout.tv_sec = CLIENT_IO_TIMEOUT;
+	timeout.tv_usec = 0;
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	clients[i].fd = client;
+	clients[i].received = 0;
+	clients[i].lastActive = time(0);
+}
+
+int fc_serve(const char* socketPath, fc_request_handler handler, void* userdata) {
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	struct pollfd fds[MAX_CLIENTS + 1];
+	client_conn clients[MAX_CLIENTS];
+	int conns[MAX_CLIENTS + 1];
+	fc_sink out;
+	fc_sink log;
+	mode_t mask;
+	int fd;
+	int res;
+	int i;
+
+	if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path is too long!\n");
+		return -1;
+	}
+	if (remove_stale_socket(socketPath) < 0) {
+		fprintf(stderr, "%s: %s\n", socketPath,
+				errno == EEXIST ? "File exists and is not a socket" : strerror(errno));
+		return -1;
+	}
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		perror("socket");
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+	// Only owner may connect: requests read font files with daemon permissions
+	mask = umask(077);
+	res = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+	umask(mask);
+	if (res < 0 || chmod(socketPath, 0600) < 0 || listen(fd, 8) < 0) {
+		perror(socketPath);
+		close(fd);
+		return -1;
+	}
+
+	// No SA_RESTART: blocking poll() must be interrupted to stop the daemon
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stop_handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, 0);
+	sigaction(SIGTERM, &sa, 0);
+	signal(SIGPIPE, SIG_IGN);
+
+	for (i = 0; i < MAX_CLIENTS; i++) {
+		clients[i].fd = -1;
+		clients[i].buffer = 0;
+	}
+	fc_sink_init_memory(&out, 0, 0);
+	fc_sink_init_memory(&log, 0, 0);
+	while (!stop_requested) {
+		time_t now = time(0);
+		int count = 0;
+
+		fds[count].fd = fd;
+		fds[count].events = POLLIN;
+		conns[count++] = -1;
+		for (i = 0; i < MAX_CLIENTS; i++) {
+			if (clients[i].fd < 0)
+				continue;
+			if (now - clients[i].lastActive >= CLIENT_IDLE_TIMEOUT) {
+				close_client(&clients[i]);
+				continue;
+			}
+			fds[count].fd = clients[i].fd;
+			fds[count].events = POLLIN;
+			conns[count++] = i;
+		}
+
+		res = poll(fds, (nfds_t)count, POLL_INTERVAL_MS);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+		for (i = 1; i < count; i++) {
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				client_conn* conn = &clients[conns[i]];
+				if (!receive_request(conn, handler, userdata, &out, &log))
+					close_client(conn);
+			}
+		}
+		if (fds[0].revents & POLLIN)
+			accept_client(fd, clients);
+	}
+	for (i = 0; i < MAX_CLIENTS; i++)
+		if (clients[i].fd >= 0)
+			close_client(&clients[i]);
+	fc_sink_free(&out);
+	fc_sink_free(&log);
+	close(fd);
+	unlink(socketPath);
+	return 0;
+}
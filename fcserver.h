@@ -0,0 +1,55 @@
+/*
+Local conversion daemon of the fontconvert utility.
+
+Listens on UNIX domain socket (accessible by owner only) and serves
+conversion requests one by one; connected clients are multiplexed, so one
+idle client does not block others. A client may send any number of requests
+over one connection, connections idle for 60 seconds are closed.
+Requests may not use options reading or writing files other than the font
+(--layout, --layout-out, --patch, --serve).
+All integers are 32-bit little-endian.
+
+Request:
+  uint32  payload length
+  payload command line arguments (same as for fontconvert, including
+          font file path), each terminated by zero byte
+Response:
+  int32   status, 0 on success
+  uint32  output length
+  uint32  log length
+  output  converted font in requested format
+  log     diagnostic messages (warnings, error description)
+*/
+
+#ifndef _FCSERVER_H_
+#define _FCSERVER_H_
+
+#include "libfontconvert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FC_SERVE_MAX_REQUEST	65536
+
+/**
+ * Request handler: argv[0] is program name, argv[1..argc-1] are request
+ * arguments. Returns status sent to the client.
+ */
+typedef int (*fc_request_handler)(void* userdata, int argc, char* argv[], fc_sink* out, fc_sink* log);
+
+/**
+ * @brief Serve conversion requests until SIGINT or SIGTERM
+ * @param socketPath path of UNIX domain socket to listen on
+ * @param handler request handler
+ * @param userdata pointer passed to request handler
+ * @return 0 on normal shutdown, -1 on socket error or if socketPath
+ *         exists and is not a socket.
+ */
+int fc_serve(const char* socketPath, fc_request_handler handler, void* userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FCSERVER_H_
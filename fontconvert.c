@@ -16,47 +16,24 @@ Modified by Chernov A.A. <valexlin@gmail.com>
  * Added field bitmapSize to struct GFXfont.
  * Added command line parsing via gnugetopt_long().
  * Added command line argument to specify DPI.
+ * Added compact (bit-packed) glyph metrics table output.
+ * Moved conversion into libfontconvert, added binary output format.
+ * Added local conversion daemon mode (--serve).
+ * Added stable glyph layout and patch output for incremental updates.
 */
 #ifndef ARDUINO
 
-#include <ctype.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 
-#include <ft2build.h>
-#include FT_GLYPH_H
-#include FT_MODULE_H
-#include FT_TRUETYPE_DRIVER_H
-
-#include "gfxfont.h" // patched Adafruit_GFX font structures
+#include "libfontconvert.h"
+#include "fcserver.h"
 
 #define MAX_S_LEN		512
-#define MAX_GLYPH_NAME_LEN	128
-#define MAX_NUMBER_STR_SZ	9
-#define MAX_RANGE_SZ	64
-
-// Accumulate bits for output, with periodic hexadecimal byte write
-void enbit(uint8_t value) {
-	static uint8_t row = 0, sum = 0, bit = 0x80, firstCall = 1;
-	if (value)
-		sum |= bit;          // Set bit if needed
-	if (!(bit >>= 1)) {    // Advance to next bit, end of byte reached?
-		if (!firstCall) {    // Format output table nicely
-			if (++row >= 12) { // Last entry on line?
-				printf(",\n  "); //   Newline format output
-				row = 0;         //   Reset row counter
-			} else {           // Not end of line
-				printf(", ");    //   Simple comma delim
-			}
-		}
-		printf("0x%02X", sum); // Write byte value
-		sum = 0;               // Clear for next byte
-		bit = 0x80;            // Reset bit counter
-		firstCall = 0;         // Formatting flag
-	}
-}
+#define SERVE_FACE_CACHE_SZ	16
 
 static void print_help() {
 	printf("Usage: fontconvert <options> [font_file]\n");
@@ -75,143 +52,41 @@ static void print_help() {
 	printf("--dpi=<dpi_value>            |-d        specify DPI\n");
 	printf("--hinting=[no|mono|auto]     |-t        specify hinting mode\n");
 	printf("--progmem[=1|0|yes|no]       |-d        use 'PROGMEM' specification for font data declarations\n");
+	printf("--compact[=1|0|yes|no]       |-k        output bit-packed glyph table (GFXfontCompact)\n");
+	printf("--format=[header|binary]     |-f        specify output format\n");
+	printf("--layout=<manifest>                     keep glyph bitmap placement of previous build\n");
+	printf("--layout-out=<manifest>                 write layout manifest of this build\n");
+	printf("--patch=<patch_file>                    write binary patch from previous build (requires --layout)\n");
+	printf("--serve=<socket_path>                   run as local conversion daemon on UNIX socket\n");
 	printf("--help                       |-h        show this page and exit.\n");
 }
 
-static int my_atoi(const char* str) {
-	if (!str || !str[0])
-		return -1;
-	size_t len = strlen(str);
-	char* strcp = 0;
-	int res = 0;
-	char* endptr = 0;
-	if (len > 1 && str[len - 1] == 'h') {
-		strcp = strdup(str);
-		strcp[len - 1] = 0;
-		res = strtol(strcp, &endptr, 16);
-	} else
-		res = strtol(str, &endptr, 0);
-	if (*endptr != 0)
-		res = -1;
-	if (strcp)
-		free(strcp);
-	return res;
-}
-
-/**
- * @brief Parse string as ranges list into GFXglyphRange array
- * @param ranges destination array of ranges
- * @param str insput string
- * @return count of records if parsed successfully, -1 otherwise.
- *
- * Example of strings that can be used:
- *   0x20-0x7E,0xA9,0xAE
- *   20h-7Eh,A9h,AEh
- *   0x20-0x7E,0x401,0x410-0x44F,0x451,0xA9,0xAE
- */
-static int parse_ranges(GFXglyphRange* ranges, const char* str, int max_sz) {
-	int res = -1;
-	const char* ptr = str;
-	int i = 0;
-	uint16_t first = 0;
-	uint16_t last = 0;
-	char number_str[MAX_NUMBER_STR_SZ];
-	char* number_str_ins_ptr = number_str;
-	int have_errors = 0;
-	while (1) {
-		if (*ptr == '-') {
-			first = (uint16_t)my_atoi(number_str);
-			if (first == (uint16_t)-1) {
-				have_errors = 1;
-				break;
-			}
-			// prepare for next number
-			number_str_ins_ptr = number_str;
-		} else if (*ptr == ',' || *ptr == ';' || *ptr == 0) {
-			last = my_atoi(number_str);
-			if (last == (uint16_t)-1) {
-				have_errors = 1;
-				break;
-			}
-			if (last < first) {
-				have_errors = 1;
-				break;
-			}
-			if (0 == first)
-				first = last;
-			ranges[i].first = first;
-			ranges[i].last = last;
-			// prepare for next number pair
-			i++;
-			first = 0;
-			last = 0;
-			number_str_ins_ptr = number_str;
-		} else {
-			if (number_str_ins_ptr - number_str < MAX_NUMBER_STR_SZ - 1) {
-				*number_str_ins_ptr = *ptr;
-				number_str_ins_ptr++;
-				*number_str_ins_ptr = 0;
-			} else {
-				have_errors = 1;
-				break;
-			}
-		}
-		if (i >= max_sz)
-			break;
-		if (*ptr == 0)
-			break;
-		ptr++;
-	}
-	if (!have_errors)
-		res = i;
-	return res;
-}
-
-static int range_comparator(const void * n1, const void * n2) {
-	GFXglyphRange* r1 = (GFXglyphRange*)n1;
-	GFXglyphRange* r2 = (GFXglyphRange*)n2;
-	if (r1->first > r2->first)
-		return 1;
-	else if (r1->first < r2->first)
-		return -1;
-	int r1_sz = r1->last - r1->first + 1;
-	int r2_sz = r2->last - r2->first + 1;
-	return r1_sz == r2_sz ? 0 : (r1_sz > r2_sz ? 1 : -1);
-}
-
-int main(int argc, char *argv[]) {
-	int i, j;
-	int err;
-	int size = 0;
+// Parsed command line
+typedef struct {
+	fc_options opts;
+	const fc_emitter* emitter;
+	char filePath[MAX_S_LEN];
+	char serveSocket[MAX_S_LEN];
+	char layoutIn[MAX_S_LEN];
+	char layoutOut[MAX_S_LEN];
+	char patchOut[MAX_S_LEN];
+} cmdline;
+
+#define PARSE_OK		0
+#define PARSE_ERROR		1
+#define PARSE_HELP		2
+
+// Parse command line arguments, error messages are written to 'err'
+static int parse_cmdline(int argc, char *argv[], cmdline* cmd, fc_sink* err) {
 	int one_char = 0;
 	int ascii_mode = 0;
-	int use_progmem = 0;
-	unsigned int bitmapOffset = 0;
-	int x, y, byte;
-	int dpi = 96;
-	int hinting = 1;	// 0 - no, 1 - mono, 2 - auto
-	char c, *ptr;
 	int help_only = 0;
-	char filePath[MAX_S_LEN] = { 0 };
-	char* fontName;
-	FT_Library library;
-	FT_Face face;
-	FT_Glyph glyph;
-	FT_Int32 load_flags;
-	FT_Bitmap *bitmap;
-	FT_BitmapGlyphRec *g;
-	GFXglyph *table;
-	GFXglyphRange ranges[MAX_RANGE_SZ];
 	int ranges_count = 0;
 	int range_specified = 0;
-	int chars_count = 0;
-	FT_UInt* table_glyphs;
-	FT_ULong char_;
-	uint8_t bit;
-	char glyphName[MAX_GLYPH_NAME_LEN] = { 0 };
 
-	// Unless overridden, default first and last chars are
-	// ' ' (space) and '~', respectively
+	memset(cmd, 0, sizeof(cmdline));
+	fc_options_init(&cmd->opts);
+	cmd->emitter = &fc_emitter_header;
 
 	// parse command line
 	while (1) {
@@ -223,6 +98,12 @@ int main(int argc, char *argv[]) {
 			{"dpi",     required_argument, 0, 'd'},
 			{"hinting", required_argument, 0, 't'},
 			{"progmem", optional_argument, 0, 'p'},
+			{"compact", optional_argument, 0, 'k'},
+			{"format",  required_argument, 0, 'f'},
+			{"serve",   required_argument, 0, 'S'},
+			{"layout",  required_argument, 0, 'L'},
+			{"layout-out", required_argument, 0, 'O'},
+			{"patch",   required_argument, 0, 'P'},
 			{"help",    no_argument,       0, 'h'},
 			{0, 0, 0, 0}
 		};
@@ -230,7 +111,7 @@ int main(int argc, char *argv[]) {
 		/* getopt_long stores the option index here. */
 		int option_index = 0;
 
-		ret = getopt_long(argc, argv, "s:f:l:c:ad:t:ph?",
+		ret = getopt_long(argc, argv, "s:f:l:c:ad:t:pkh?",
 						  long_options, &option_index);
 
 		/* Detect the end of the options. */
@@ -241,414 +122,309 @@ int main(int argc, char *argv[]) {
 			case 0:
 				break;
 			case 's':
-				size = atoi(optarg);
+				cmd->opts.size = atoi(optarg);
 				break;
 			case 'r':
-				ranges_count = parse_ranges(ranges, optarg, MAX_RANGE_SZ);
+				ranges_count = fc_parse_ranges(cmd->opts.ranges, optarg, FC_MAX_RANGES);
 				range_specified = 1;
 				break;
 			case 'c':
-				one_char = my_atoi(optarg);
+				one_char = fc_atoi(optarg);
 				break;
 			case 'a':
 				ascii_mode = 1;
 				break;
 			case 'd':
-				dpi = atoi(optarg);
+				cmd->opts.dpi = atoi(optarg);
 				break;
 			case 't':
 				if (strcasecmp(optarg, "no") == 0)
-					hinting = 0;
+					cmd->opts.hinting = FC_HINTING_NO;
 				else if (strcasecmp(optarg, "mono") == 0)
-					hinting = 1;
+					cmd->opts.hinting = FC_HINTING_MONO;
 				else if (strcasecmp(optarg, "auto") == 0)
-					hinting = 2;
+					cmd->opts.hinting = FC_HINTING_AUTO;
 			case 'p':
 				if (optarg) {
 					if (strcasecmp(optarg, "yes") == 0 || strcmp(optarg, "1") == 0)
-						use_progmem = 1;
+						cmd->opts.progmem = 1;
 					else
-						use_progmem = 0;
+						cmd->opts.progmem = 0;
 				}
 				else
-					use_progmem = 1;
+					cmd->opts.progmem = 1;
+				break;
+			case 'k':
+				if (optarg) {
+					if (strcasecmp(optarg, "yes") == 0 || strcmp(optarg, "1") == 0)
+						cmd->opts.compact = 1;
+					else
+						cmd->opts.compact = 0;
+				}
+				else
+					cmd->opts.compact = 1;
+				break;
+			case 'f':
+				if (!(cmd->emitter = fc_find_emitter(optarg))) {
+					fc_sink_printf(err, "Unknown output format '%s'!\n", optarg);
+					return PARSE_ERROR;
+				}
+				break;
+			case 'S':
+				strncpy(cmd->serveSocket, optarg, MAX_S_LEN);
+				cmd->serveSocket[MAX_S_LEN - 1] = 0;
+				break;
+			case 'L':
+				strncpy(cmd->layoutIn, optarg, MAX_S_LEN);
+				cmd->layoutIn[MAX_S_LEN - 1] = 0;
+				break;
+			case 'O':
+				strncpy(cmd->layoutOut, optarg, MAX_S_LEN);
+				cmd->layoutOut[MAX_S_LEN - 1] = 0;
+				break;
+			case 'P':
+				strncpy(cmd->patchOut, optarg, MAX_S_LEN);
+				cmd->patchOut[MAX_S_LEN - 1] = 0;
 				break;
 			case 'h':
 			case '?':
 				help_only = 1;
 				break;
 			default:
-				return -1;
+				return PARSE_ERROR;
 		}
 	}
 	if (optind < argc) {
-		strncpy(filePath, argv[optind++], MAX_S_LEN);
-		filePath[MAX_S_LEN - 1] = 0;
-	}
-	if (help_only) {
-		print_help();
-		return 0;
+		strncpy(cmd->filePath, argv[optind++], MAX_S_LEN);
+		cmd->filePath[MAX_S_LEN - 1] = 0;
 	}
-	if (filePath[0] == 0) {
-		fprintf(stderr, "You must specify path to the font file!\n");
-		print_help();
-		return 1;
+	if (help_only)
+		return PARSE_HELP;
+	if (cmd->serveSocket[0])
+		return PARSE_OK;
+	if (cmd->filePath[0] == 0) {
+		fc_sink_printf(err, "You must specify path to the font file!\n");
+		return PARSE_ERROR;
 	}
-	if (size == 0) {
-		fprintf(stderr, "You must specify valid font size!\n");
-		print_help();
-		return 1;
+	if (cmd->opts.size == 0) {
+		fc_sink_printf(err, "You must specify valid font size!\n");
+		return PARSE_ERROR;
 	}
+	cmd->opts.filePath = cmd->filePath;
 
 	if (range_specified) {
 		if (ranges_count < 0) {
-			fprintf(stderr, "Failed to parse characters set ranges!\n");
-			print_help();
-			return 1;
+			fc_sink_printf(err, "Failed to parse characters set ranges!\n");
+			return PARSE_ERROR;
 		}
-		// Sort character set ranges
-		qsort(ranges, (size_t)ranges_count, sizeof(GFXglyphRange), range_comparator);
 		// validate ranges: check duplicates and/or interceptions
-		int have_errors = 0;
-		for (i = 1; i < ranges_count; i++) {
-			if (ranges[i].first >= ranges[i - 1].first && ranges[i].first <= ranges[i - 1].last) {
-				have_errors = 1;
-				break;
-			} else if (ranges[i].last < ranges[i - 1].last) {
-				have_errors = 1;
-				break;
-			}
-		}
-		if (have_errors) {
-			fprintf(stderr, "In characters set ranges found duplicates or interceptions!\n");
-			print_help();
-			return 1;
-		}
-		// Combine consecutive ranges
-		for (i = ranges_count - 1; i > 0; i--) {
-			if (ranges[i].first == ranges[i - 1].last + 1) {
-				ranges[i - 1].last = ranges[i].last;
-				for (j = i; j < ranges_count - 1; j++)
-					memcpy(&ranges[j], &ranges[j + 1], sizeof(GFXglyphRange));
-				ranges_count--;
-			}
+		if (fc_normalize_ranges(cmd->opts.ranges, &ranges_count) != FC_OK) {
+			fc_sink_printf(err, "In characters set ranges found duplicates or interceptions!\n");
+			return PARSE_ERROR;
 		}
 	}
 	if (ascii_mode) {
 		if (ranges_count > 0) {
-			fprintf(stderr, "In ASCII mode, the character set ranges can't specified!\n");
-			print_help();
-			return 1;
+			fc_sink_printf(err, "In ASCII mode, the character set ranges can't specified!\n");
+			return PARSE_ERROR;
 		}
 		if (one_char != 0) {
-			fprintf(stderr, "You cannot specify both ASCII mode and single character mode!\n");
-			print_help();
-			return 1;
+			fc_sink_printf(err, "You cannot specify both ASCII mode and single character mode!\n");
+			return PARSE_ERROR;
 		}
-		ranges[0].first = 0x20;		// ' ' SPACE
-		ranges[0].last = 0x7E;		// '~' TILDE
+		cmd->opts.ranges[0].first = 0x20;		// ' ' SPACE
+		cmd->opts.ranges[0].last = 0x7E;		// '~' TILDE
 		ranges_count = 1;
 	}
 	if (one_char != 0) {
 		if (one_char < 0) {
-			fprintf(stderr, "Invalid character code!\n");
-			print_help();
-			return 1;
+			fc_sink_printf(err, "Invalid character code!\n");
+			return PARSE_ERROR;
 		}
 		if (ranges_count > 0) {
-			fprintf(stderr, "In one char mode, the character set ranges can't specified!\n");
-			print_help();
-			return 1;
+			fc_sink_printf(err, "In one char mode, the character set ranges can't specified!\n");
+			return PARSE_ERROR;
 		} else {
-			ranges[0].first = one_char;
-			ranges[0].last = one_char;
+			cmd->opts.ranges[0].first = one_char;
+			cmd->opts.ranges[0].last = one_char;
 			ranges_count = 1;
 		}
 	}
 	if (ranges_count == 0) {
-		ranges[0].first = 0x20;		// ' ' SPACE
-		ranges[0].last = 0x7E;		// '~' TILDE
+		cmd->opts.ranges[0].first = 0x20;		// ' ' SPACE
+		cmd->opts.ranges[0].last = 0x7E;		// '~' TILDE
 		ranges_count = 1;
 	}
-	if (dpi == 0) {
-		fprintf(stderr, "Invalid value of DPI!\n");
-		return 1;
+	cmd->opts.rangesCount = ranges_count;
+	if (cmd->opts.dpi == 0) {
+		fc_sink_printf(err, "Invalid value of DPI!\n");
+		return PARSE_ERROR;
 	}
-
-	// MONO renderer provides clean image with perfect crop
-	// (no wasted pixels) via bitmap struct.
-	switch (hinting) {
-		case 0:		// no
-			load_flags = FT_LOAD_NO_HINTING;
-			break;
-		case 1:		// mono
-			load_flags = FT_LOAD_TARGET_MONO;
-			break;
-		case 2:		// auto
-			load_flags = FT_LOAD_TARGET_MONO | FT_LOAD_FORCE_AUTOHINT;
-			break;
-		default:	// mono
-			load_flags = FT_LOAD_TARGET_MONO;
-			break;
+	if (cmd->patchOut[0] && !cmd->layoutIn[0]) {
+		fc_sink_printf(err, "Patch requires layout manifest of previous build (--layout)!\n");
+		return PARSE_ERROR;
 	}
+	return PARSE_OK;
+}
 
-	ptr = strrchr(filePath, '/'); // Find last slash in filename
-	if (ptr)
-		ptr++; // First character of filename (path stripped)
-	else
-		ptr = filePath; // No path; font in local dir.
-
-	// Calc table size (characters count)
-	chars_count = 0;
-	for (i = 0; i < ranges_count; i++)
-		chars_count += ranges[i].last - ranges[i].first + 1;
+// Write layout manifest or patch to file
+static int write_file(const char* path, const fc_layout* prev, const fc_font* font,
+					  const fc_options* opts, fc_sink* log) {
+	FILE* file;
+	fc_sink sink;
+	int err;
 
-	// Allocate space for font name and glyph table
-	if ((!(fontName = malloc(strlen(ptr) + 28))) ||
-		(!(table = (GFXglyph *)malloc(chars_count * sizeof(GFXglyph)))) ||
-		(!(table_glyphs = (FT_UInt *)malloc(chars_count * sizeof(FT_UInt))))) {
-		fprintf(stderr, "malloc error\n");
+	if (!(file = fopen(path, "wb"))) {
+		fc_sink_printf(log, "Failed to create file '%s'!\n", path);
 		return 1;
 	}
-
-	// Derive font table names from filename.  Period (filename
-	// extension) is truncated and replaced with the font size & bits.
-	strcpy(fontName, ptr);
-	ptr = strrchr(fontName, '.'); // Find last period (file ext)
-	if (!ptr)
-		ptr = &fontName[strlen(fontName)]; // If none, append
-	if (1 == ranges_count) {
-		// Insert font size.  fontName was alloc'd w/extra
-		// space to allow this, we're not sprintfing into Forbidden Zone.
-		if (ranges[0].first == ranges[0].last)
-			sprintf(ptr, "%dpt_char%02X", size, ranges[0].first);
-		else if (ranges[0].first == 0x20 && ranges[0].last == 0x7E)
-			sprintf(ptr, "%dpt_ascii", size);
-		else
-			sprintf(ptr, "%dpt_%02X_%02X", size, ranges[0].first, ranges[0].last);
-	}
+	fc_sink_init_file(&sink, file);
+	if (prev)
+		err = fc_make_patch(prev, font, opts, &sink);
 	else
-	{
-		sprintf(ptr, "%dpt_mixed", size);
-	}
-	// Space and punctuation chars in name replaced w/ underscores.
-	for (i = 0; (c = fontName[i]); i++) {
-		if (isspace(c) || ispunct(c))
-			fontName[i] = '_';
+		err = fc_layout_write(font, opts, &sink);
+	if (fclose(file) != 0 && err == FC_OK)
+		err = FC_ERR_IO;
+	if (err != FC_OK) {
+		fc_sink_printf(log, "Failed to write file '%s': %s\n", path, fc_strerror(err));
+		return 1;
 	}
+	return 0;
+}
 
-	// Init FreeType lib, load font
-	if ((err = FT_Init_FreeType(&library))) {
-		fprintf(stderr, "FreeType init error: %d\n", err);
-		return err;
+// Convert font and write it to 'out', arena is (re)allocated as needed
+static int run_conversion(fc_context* ctx, cmdline* cmd, fc_arena* arena, fc_sink* out, fc_sink* log) {
+	int err;
+	int res = 1;
+	fc_font font;
+	fc_layout layout;
+	FILE* file;
+	size_t arena_size;
+
+	if (cmd->layoutIn[0]) {
+		if (!(file = fopen(cmd->layoutIn, "r"))) {
+			fc_sink_printf(log, "Failed to open layout manifest '%s'!\n", cmd->layoutIn);
+			return 1;
+		}
+		err = fc_layout_read(&layout, file);
+		fclose(file);
+		if (err != FC_OK) {
+			fc_sink_printf(log, "Failed to read layout manifest '%s': %s\n", cmd->layoutIn, fc_strerror(err));
+			return 1;
+		}
+		cmd->opts.prevLayout = &layout;
 	}
 
-	// Use TrueType engine version 35, without subpixel rendering.
-	// This improves clarity of fonts since this library does not
-	// support rendering multiple levels of gray in a glyph.
-	// See https://github.com/adafruit/Adafruit-GFX-Library/issues/103
-	FT_UInt interpreter_version = TT_INTERPRETER_VERSION_35;
-	FT_Property_Set(library, "truetype", "interpreter-version",
-					&interpreter_version);
-
-	if ((err = FT_New_Face(library, filePath, 0, &face))) {
-		fprintf(stderr, "Font load error: %d\n", err);
-		FT_Done_FreeType(library);
-		return err;
+	arena_size = fc_arena_size_hint(&cmd->opts);
+	if (arena->size < arena_size) {
+		fc_arena_free(arena);
+		if (fc_arena_init(arena, NULL, arena_size) != FC_OK) {
+			fc_sink_printf(log, "malloc error\n");
+			goto done;
+		}
 	}
-
-	// << 6 because '26dot6' fixed-point format
-	if ((err = FT_Set_Char_Size(face, size << 6, 0, dpi, 0))) {
-		fprintf(stderr, "Set font char size error: %d\n", err);
-		FT_Done_FreeType(library);
-		return err;
+	fc_arena_reset(arena);
+	cmd->opts.log = log;
+	if ((err = fc_convert(ctx, &cmd->opts, arena, &font)) != FC_OK) {
+		if (err != FC_ERR_FREETYPE)
+			fc_sink_printf(log, "Conversion error: %s\n", fc_strerror(err));
+		goto done;
 	}
-
-	// Always use unicode charmap
-	if ((err = FT_Select_Charmap(face, FT_ENCODING_UNICODE))) {
-		fprintf(stderr, "Select unicode charmap error: %d\n", err);
-		FT_Done_FreeType(library);
-		return err;
+	if ((err = fc_emit(cmd->emitter, &font, &cmd->opts, out)) != FC_OK) {
+		fc_sink_printf(log, "Output error: %s\n", fc_strerror(err));
+		goto done;
 	}
+	if (cmd->layoutOut[0] && write_file(cmd->layoutOut, NULL, &font, &cmd->opts, log))
+		goto done;
+	if (cmd->patchOut[0] && write_file(cmd->patchOut, &layout, &font, &cmd->opts, log))
+		goto done;
+	res = 0;
+
+done:
+	if (cmd->opts.prevLayout) {
+		cmd->opts.prevLayout = NULL;
+		fc_layout_free(&layout);
+	}
+	return res;
+}
 
-	// Print header
-	printf("/*******************************************************************\n");
-	printf(" *  Generated by fontconvert utility:\n");
-	printf(" * Font Name: '%s', filepath: '%s'\n", face->family_name, filePath);
-	printf(" * Size: %dpt\n", size);
-	printf(" * DPI: %d\n", dpi);
-	printf(" * Hinting: ");
-	switch (hinting) {
-		case 0:
-			printf("no");
-			break;
-		case 1:
-			printf("mono");
-			break;
-		case 2:
-			printf("auto");
+// Conversion daemon state
+typedef struct {
+	fc_context* ctx;
+	fc_arena arena;
+} serve_state;
+
+static int serve_request(void* userdata, int argc, char* argv[], fc_sink* out, fc_sink* log) {
+	serve_state* state = (serve_state*)userdata;
+	cmdline cmd;
+
+	// Reinitialize getopt for each request, don't print its own messages
+	optind = 0;
+	opterr = 0;
+	switch (parse_cmdline(argc, argv, &cmd, log)) {
+		case PARSE_OK:
 			break;
+		case PARSE_HELP:
+			fc_sink_printf(log, "Invalid option!\n");
+			return 1;
 		default:
-			printf("mono");
-			break;
-	}
-	printf("\n");
-	printf("Characters set ranges:\n");
-	for (i = 0; i < ranges_count; i++) {
-		printf("  %d: 0x%04X - 0x%04X (", i, ranges[i].first, ranges[i].last);
-		table_glyphs[0] = FT_Get_Char_Index(face, ranges[i].first);
-		if ((err = FT_Get_Glyph_Name(face, table_glyphs[0], glyphName, MAX_GLYPH_NAME_LEN)) == 0)
-			glyphName[MAX_GLYPH_NAME_LEN - 1] = 0;
-		else
-			strcpy(glyphName, "unknown");
-		printf("'%s' - ", glyphName);
-		table_glyphs[0] = FT_Get_Char_Index(face, ranges[i].last);
-		if ((err = FT_Get_Glyph_Name(face, table_glyphs[0], glyphName, MAX_GLYPH_NAME_LEN)) == 0)
-			glyphName[MAX_GLYPH_NAME_LEN - 1] = 0;
-		else
-			strcpy(glyphName, "unknown");
-		printf("'%s')\n", glyphName);
+			return 1;
 	}
-	printf(" *******************************************************************/\n");
-	printf("\n");
-
-	// Currently all symbols from 'first' to 'last' in all character set ranges are processed.
-	// Fonts may contain WAY more glyphs than that, but this code
-	// will need to handle encoding stuff to deal with extracting
-	// the right symbols, and that's not done yet.
-	// fprintf(stderr, "%ld glyphs\n", face->num_glyphs);
-
-	if (use_progmem)
-		printf("const uint8_t %s_Bitmaps[] PROGMEM = {\n  ", fontName);
-	else
-		printf("const uint8_t %s_Bitmaps[] = {\n  ", fontName);
-
-	// Process glyphs and output huge bitmap data array
-	j = 0;
-	for (i = 0; i < ranges_count; i++) {
-		for (char_ = ranges[i].first; char_ <= ranges[i].last; char_++, j++) {
-			if ((table_glyphs[j] = FT_Get_Char_Index(face, char_)) == 0) {
-				fprintf(stderr, "undefined character code 0x%04X\n", (unsigned int)char_);
-				continue;
-			}
-
-			if ((err = FT_Load_Glyph(face, table_glyphs[j], load_flags))) {
-				fprintf(stderr, "Error %d loading char '0x%04X'\n", err, (unsigned int)char_);
-				continue;
-			}
-
-			if ((err = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_MONO))) {
-				fprintf(stderr, "Error %d rendering char '0x%04X'\n", err, (unsigned int)char_);
-				continue;
-			}
-
-			if ((err = FT_Get_Glyph(face->glyph, &glyph))) {
-				fprintf(stderr, "Error %d getting glyph '0x%04X'\n", err, (unsigned int)char_);
-				continue;
-			}
-
-			bitmap = &face->glyph->bitmap;
-			g = (FT_BitmapGlyphRec *)glyph;
-
-			// Minimal font and per-glyph information is stored to
-			// reduce flash space requirements.  Glyph bitmaps are
-			// fully bit-packed; no per-scanline pad, though end of
-			// each character may be padded to next byte boundary
-			// when needed.  16-bit offset means 64K max for bitmaps,
-			// code currently doesn't check for overflow.  (Doesn't
-			// check that size & offsets are within bounds either for
-			// that matter...please convert fonts responsibly.)
-			table[j].bitmapOffset = bitmapOffset;
-			table[j].width = bitmap->width;
-			table[j].height = bitmap->rows;
-			table[j].xAdvance = face->glyph->advance.x >> 6;
-			table[j].xOffset = g->left;
-			table[j].yOffset = 1 - g->top;
-
-			for (y = 0; y < bitmap->rows; y++) {
-				for (x = 0; x < bitmap->width; x++) {
-					byte = x / 8;
-					bit = 0x80 >> (x & 7);
-					enbit(bitmap->buffer[y * bitmap->pitch + byte] & bit);
-				}
-			}
-
-			// Pad end of char bitmap to next byte boundary if needed
-			int n = (bitmap->width * bitmap->rows) & 7;
-			if (n) {     // Pixel count not an even multiple of 8?
-				n = 8 - n; // # bits to next multiple
-				while (n--)
-					enbit(0);
-			}
-			bitmapOffset += (bitmap->width * bitmap->rows + 7) / 8;
-
-			FT_Done_Glyph(glyph);
-		}
+	// Daemon must not access files at client-chosen paths other than the font
+	if (cmd.serveSocket[0] || cmd.layoutIn[0] || cmd.layoutOut[0] || cmd.patchOut[0]) {
+		fc_sink_printf(log, "Options '--serve', '--layout', '--layout-out' and '--patch' are not allowed in request!\n");
+		return 1;
 	}
+	return run_conversion(state->ctx, &cmd, &state->arena, out, log);
+}
 
-	printf(" };\n\n"); // End bitmap array
+static int serve(const char* socketPath) {
+	serve_state state;
+	int res;
 
-	// Output glyph attributes table (one per character)
-	if (use_progmem)
-		printf("const GFXglyph %s_Glyphs[] PROGMEM = {\n", fontName);
-	else
-		printf("const GFXglyph %s_Glyphs[] = {\n", fontName);
-	j = 0;
-	for (i = 0; i < ranges_count; i++) {
-		for (char_ = ranges[i].first; char_ <= ranges[i].last; char_++, j++) {
-			printf("  { %5d, %3d, %3d, %3d, %4d, %4d }", table[j].bitmapOffset,
-				   table[j].width, table[j].height, table[j].xAdvance, table[j].xOffset,
-				   table[j].yOffset);
-			if ((err = FT_Get_Glyph_Name(face, table_glyphs[j], glyphName, MAX_GLYPH_NAME_LEN)) == 0)
-				glyphName[MAX_GLYPH_NAME_LEN - 1] = 0;
-			else
-				glyphName[0] = 0;
-			if (i == ranges_count - 1 && char_ == ranges[i].last) {
-				printf(" }; // 0x%02X", (unsigned int)char_);
-				if (glyphName[0])
-					printf(" '%s'", glyphName);
-			} else {
-				printf(",   // 0x%02X", (unsigned int)char_);
-				if (glyphName[0])
-					printf(" '%s'", glyphName);
-			}
-			printf("\n");
-		}
+	memset(&state, 0, sizeof(state));
+	if (!(state.ctx = fc_context_new())) {
+		fprintf(stderr, "FreeType init error\n");
+		return 1;
 	}
-	printf("\n");
-
-	// Output characters set range list
-	if (use_progmem)
-		printf("const GFXglyphRange %s_Ranges[] PROGMEM = {\n", fontName);
-	else
-		printf("const GFXglyphRange %s_Ranges[] = {\n", fontName);
-	for (i = 0; i < ranges_count - 1; i++) {
-		printf("  { 0x%04X, 0x%04X },\n", ranges[i].first, ranges[i].last);
+	if (fc_context_set_cache_size(state.ctx, SERVE_FACE_CACHE_SZ) != FC_OK) {
+		fprintf(stderr, "malloc error\n");
+		fc_context_free(state.ctx);
+		return 1;
 	}
-	printf("  { 0x%04X, 0x%04X } };\n", ranges[ranges_count - 1].first, ranges[ranges_count - 1].last);
-	printf("\n");
+	res = fc_serve(socketPath, serve_request, &state);
+	fc_arena_free(&state.arena);
+	fc_context_free(state.ctx);
+	return res != 0 ? 1 : 0;
+}
 
-	// Output font structure
-	if (use_progmem)
-		printf("const GFXfont %s PROGMEM = {\n", fontName);
-	else
-		printf("const GFXfont %s = {\n", fontName);
-	printf("  %s_Bitmaps,\n", fontName);
-	printf("  %s_Glyphs,\n", fontName);
-	printf("  %s_Ranges, %d,\n", fontName, ranges_count);
-	printf("  %d,		// characters count\n", chars_count);
-	if (face->size->metrics.height == 0) {
-		// No face height info, assume fixed width and get from a glyph.
-		printf("  %d,		// newline distance in pixels\n", table[0].height);
-	} else {
-		printf("  %d,		// newline distance in pixels\n", (int)(face->size->metrics.height >> 6));
+int main(int argc, char *argv[]) {
+	int res;
+	cmdline cmd;
+	fc_arena arena;
+	fc_sink out;
+	fc_sink log;
+
+	fc_sink_init_file(&log, stderr);
+	switch (parse_cmdline(argc, argv, &cmd, &log)) {
+		case PARSE_OK:
+			break;
+		case PARSE_HELP:
+			print_help();
+			return 0;
+		default:
+			print_help();
+			return 1;
 	}
-	printf("  %u };	// bitmap size\n\n", bitmapOffset);
-	printf("// Approx. %u bytes\n", (unsigned int)(bitmapOffset + chars_count*sizeof(GFXglyph) + ranges_count*sizeof(GFXglyphRange) + sizeof(GFXfont)));
+	if (cmd.serveSocket[0])
+		return serve(cmd.serveSocket);
 
-	FT_Done_FreeType(library);
+	memset(&arena, 0, sizeof(arena));
+	fc_sink_init_file(&out, stdout);
+	res = run_conversion(NULL, &cmd, &arena, &out, &log);
+	fc_arena_free(&arena);
 
-	return 0;
+	return res;
 }
 
 /* -------------------------------------------------------------------------
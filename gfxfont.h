@@ -7,6 +7,7 @@
 // Modified by Chernov A.A. <valexlin@gmail.com> (2018-2021)
 // Added field bitmapSize to struct GFXfont.
 // Added the ability to include multiple character ranges in one font file.
+// Added optional compact (bit-packed) glyph metrics table, GFXfontCompact.
 
 #ifndef _GFXFONT_H_
 #define _GFXFONT_H_
@@ -35,4 +36,127 @@ typedef struct { // Data stored for FONT AS A WHOLE:
 	uint16_t  bitmapSize;			// Size of Glyph bitmaps
 } GFXfont;
 
+// Compact font variant: per-glyph metrics are bit-packed into fixed size
+// little-endian records using the minimal field widths for this font,
+// xOffset/yOffset are stored biased by a per-font minimum (unsigned).
+// Fields are packed from the least significant bit in this order:
+// bitmapOffset, width, height, xAdvance, xOffset, yOffset.
+// Ranges are stored as little-endian first/last pairs of 16-bit (with
+// GFX_COMPACT_RANGES16 flag) or 32-bit values, so the byte arrays decode
+// the same way on any target.
+// Accessors below read the GFXfontCompact structure itself directly, so on
+// targets with separate program memory copy it to RAM first.
+
+// Define to read one byte from font data (e.g. pgm_read_byte for PROGMEM).
+#ifndef GFX_COMPACT_READ_BYTE
+#define GFX_COMPACT_READ_BYTE(addr) (*(const uint8_t *)(addr))
+#endif
+
+#define GFX_COMPACT_RANGES16	0x01	// ranges stored as 16-bit pairs
+
+typedef struct {
+	uint8_t  offsetBits;			// bits of bitmapOffset field
+	uint8_t  widthBits;				// bits of width field
+	uint8_t  heightBits;			// bits of height field
+	uint8_t  xAdvanceBits;			// bits of xAdvance field
+	uint8_t  xOffsetBits;			// bits of xOffset field
+	uint8_t  yOffsetBits;			// bits of yOffset field
+	int8_t   xOffsetBias;			// added to stored xOffset
+	int8_t   yOffsetBias;			// added to stored yOffset
+	uint8_t  recordSize;			// bytes per packed glyph record
+} GFXglyphLayout;
+
+typedef struct { // Data stored for COMPACT FONT AS A WHOLE:
+	const uint8_t  *bitmap;			// Glyph bitmaps, concatenated
+	const uint8_t  *glyph;			// Packed glyph records
+	const uint8_t  *ranges;			// Packed code points ranges
+	uint8_t   rangesCount;			// count of the the code points ranges
+	uint8_t   flags;				// GFX_COMPACT_* flags
+	uint16_t  charsCount;			// characters count
+	uint8_t   yAdvance;				// Newline distance (y axis)
+	uint16_t  bitmapSize;			// Size of Glyph bitmaps
+	GFXglyphLayout layout;			// Packed glyph record layout
+} GFXfontCompact;
+
+// Read little-endian value of 'size' bytes (at most 8) from font data.
+static inline uint64_t gfxCompactRead(const uint8_t *ptr, uint8_t size) {
+	uint64_t val = 0;
+	for (; size > 0; size--)
+		val = (val << 8) | GFX_COMPACT_READ_BYTE(ptr + size - 1);
+	return val;
+}
+
+// Load packed glyph record with index 'idx'.
+static inline uint64_t gfxCompactRecord(const GFXfontCompact *font, uint16_t idx) {
+	return gfxCompactRead(font->glyph + (uint32_t)idx * font->layout.recordSize,
+						  font->layout.recordSize);
+}
+
+static inline uint32_t gfxCompactField(uint64_t rec, uint8_t shift, uint8_t bits) {
+	return (uint32_t)(rec >> shift) & (((uint32_t)1 << bits) - 1);
+}
+
+static inline uint16_t gfxCompactBitmapOffset(const GFXfontCompact *font, uint64_t rec) {
+	return (uint16_t)gfxCompactField(rec, 0, font->layout.offsetBits);
+}
+
+static inline uint8_t gfxCompactWidth(const GFXfontCompact *font, uint64_t rec) {
+	const GFXglyphLayout *l = &font->layout;
+	return (uint8_t)gfxCompactField(rec, l->offsetBits, l->widthBits);
+}
+
+static inline uint8_t gfxCompactHeight(const GFXfontCompact *font, uint64_t rec) {
+	const GFXglyphLayout *l = &font->layout;
+	return (uint8_t)gfxCompactField(rec, l->offsetBits + l->widthBits, l->heightBits);
+}
+
+static inline uint8_t gfxCompactXAdvance(const GFXfontCompact *font, uint64_t rec) {
+	const GFXglyphLayout *l = &font->layout;
+	return (uint8_t)gfxCompactField(rec, l->offsetBits + l->widthBits + l->heightBits,
+									l->xAdvanceBits);
+}
+
+static inline int8_t gfxCompactXOffset(const GFXfontCompact *font, uint64_t rec) {
+	const GFXglyphLayout *l = &font->layout;
+	return (int8_t)(gfxCompactField(rec, l->offsetBits + l->widthBits + l->heightBits +
+									l->xAdvanceBits, l->xOffsetBits) + l->xOffsetBias);
+}
+
+static inline int8_t gfxCompactYOffset(const GFXfontCompact *font, uint64_t rec) {
+	const GFXglyphLayout *l = &font->layout;
+	return (int8_t)(gfxCompactField(rec, l->offsetBits + l->widthBits + l->heightBits +
+									l->xAdvanceBits + l->xOffsetBits, l->yOffsetBits) +
+					l->yOffsetBias);
+}
+
+// Decode packed glyph record with index 'idx' into plain GFXglyph.
+static inline void gfxCompactGlyph(const GFXfontCompact *font, uint16_t idx, GFXglyph *glyph) {
+	const GFXglyphLayout *l = &font->layout;
+	uint64_t rec = gfxCompactRecord(font, idx);
+	glyph->bitmapOffset = (uint16_t)gfxCompactField(rec, 0, l->offsetBits);
+	rec >>= l->offsetBits;
+	glyph->width = (uint8_t)gfxCompactField(rec, 0, l->widthBits);
+	rec >>= l->widthBits;
+	glyph->height = (uint8_t)gfxCompactField(rec, 0, l->heightBits);
+	rec >>= l->heightBits;
+	glyph->xAdvance = (uint8_t)gfxCompactField(rec, 0, l->xAdvanceBits);
+	rec >>= l->xAdvanceBits;
+	glyph->xOffset = (int8_t)(gfxCompactField(rec, 0, l->xOffsetBits) + l->xOffsetBias);
+	rec >>= l->xOffsetBits;
+	glyph->yOffset = (int8_t)(gfxCompactField(rec, 0, l->yOffsetBits) + l->yOffsetBias);
+}
+
+// Get first/last code point of range with index 'idx'.
+static inline uint32_t gfxCompactRangeFirst(const GFXfontCompact *font, uint8_t idx) {
+	if (font->flags & GFX_COMPACT_RANGES16)
+		return (uint32_t)gfxCompactRead(font->ranges + idx * 4, 2);
+	return (uint32_t)gfxCompactRead(font->ranges + idx * 8, 4);
+}
+
+static inline uint32_t gfxCompactRangeLast(const GFXfontCompact *font, uint8_t idx) {
+	if (font->flags & GFX_COMPACT_RANGES16)
+		return (uint32_t)gfxCompactRead(font->ranges + idx * 4 + 2, 2);
+	return (uint32_t)gfxCompactRead(font->ranges + idx * 8 + 4, 4);
+}
+
 #endif // _GFXFONT_H_
@@ -0,0 +1,835 @@
+/*
+TrueType to Adafruit_GFX font converter library.
+
+Conversion core of the fontconvert utility, see libfontconvert.h.
+Derived from Peter Jakobs' Adafruit_ftGFX fork & makefont tool,
+and Paul Kourany's Adafruit_mfGFX.
+
+REQUIRES FREETYPE LIBRARY.  www.freetype.org
+*/
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <ft2build.h>
+#include FT_GLYPH_H
+#include FT_MODULE_H
+#include FT_TRUETYPE_DRIVER_H
+
+#include "libfontconvert.h"
+
+#define MAX_NUMBER_STR_SZ	9
+#define ARENA_ALIGN			sizeof(void*)
+
+#ifdef __APPLE__
+#define STAT_MTIME_NSEC(st)	((st).st_mtimespec.tv_nsec)
+#else
+#define STAT_MTIME_NSEC(st)	((st).st_mtim.tv_nsec)
+#endif
+
+// Cached face, identified by file path, inode, size and modification time.
+// Inode changes on atomic save (new file renamed over the old one),
+// nanoseconds distinguish saves within the same second.
+typedef struct {
+	char*    path;
+	dev_t    dev;
+	ino_t    ino;
+	time_t   mtime;
+	long     mtimeNsec;
+	off_t    fileSize;
+	FT_Face  face;
+	unsigned long lastUse;
+} face_cache_entry;
+
+struct fc_context {
+	FT_Library library;
+	face_cache_entry* faces;		// LRU face cache
+	int      facesCapacity;
+	unsigned long useCounter;
+};
+
+/* ---------------------------------------------------------------------- */
+/* Output sink */
+
+void fc_sink_init_file(fc_sink* sink, FILE* file) {
+	memset(sink, 0, sizeof(fc_sink));
+	sink->file = file;
+}
+
+void fc_sink_init_memory(fc_sink* sink, void* buffer, size_t capacity) {
+	memset(sink, 0, sizeof(fc_sink));
+	sink->buffer = (uint8_t*)buffer;
+	sink->capacity = buffer ? capacity : 0;
+	sink->owned = buffer ? 0 : 1;
+}
+
+void fc_sink_reset(fc_sink* sink) {
+	sink->size = 0;
+}
+
+void fc_sink_free(fc_sink* sink) {
+	if (sink->owned && sink->buffer)
+		free(sink->buffer);
+	sink->buffer = 0;
+	sink->size = 0;
+	sink->capacity = 0;
+}
+
+// Ensure memory sink can hold 'size' more bytes
+static int sink_reserve(fc_sink* sink, size_t size) {
+	if (sink->size + size <= sink->capacity)
+		return FC_OK;
+	if (!sink->owned)
+		return FC_ERR_NOMEM;
+	size_t capacity = sink->capacity ? sink->capacity : 4096;
+	while (capacity < sink->size + size)
+		capacity *= 2;
+	uint8_t* buffer = (uint8_t*)realloc(sink->buffer, capacity);
+	if (!buffer)
+		return FC_ERR_NOMEM;
+	sink->buffer = buffer;
+	sink->capacity = capacity;
+	return FC_OK;
+}
+
+int fc_sink_write(fc_sink* sink, const void* data, size_t size) {
+	if (sink->file) {
+		if (size && fwrite(data, 1, size, sink->file) != size)
+			return FC_ERR_IO;
+		return FC_OK;
+	}
+	int err = sink_reserve(sink, size);
+	if (err != FC_OK)
+		return err;
+	memcpy(sink->buffer + sink->size, data, size);
+	sink->size += size;
+	return FC_OK;
+}
+
+static int sink_vprintf(fc_sink* sink, const char* format, va_list args) {
+	if (sink->file)
+		return vfprintf(sink->file, format, args) < 0 ? FC_ERR_IO : FC_OK;
+	va_list args2;
+	va_copy(args2, args);
+	int len = vsnprintf(0, 0, format, args2);
+	va_end(args2);
+	if (len < 0)
+		return FC_ERR_IO;
+	// reserve space for terminating zero written by vsnprintf
+	int err = sink_reserve(sink, (size_t)len + 1);
+	if (err != FC_OK)
+		return err;
+	vsnprintf((char*)sink->buffer + sink->size, (size_t)len + 1, format, args);
+	sink->size += (size_t)len;
+	return FC_OK;
+}
+
+int fc_sink_printf(fc_sink* sink, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int err = sink_vprintf(sink, format, args);
+	va_end(args);
+	return err;
+}
+
+static void fc_log(const fc_options* opts, const char* format, ...)
+#ifdef __GNUC__
+	__attribute__((format(printf, 2, 3)))
+#endif
+	;
+
+static void fc_log(const fc_options* opts, const char* format, ...) {
+	if (!opts->log)
+		return;
+	va_list args;
+	va_start(args, format);
+	sink_vprintf(opts->log, format, args);
+	va_end(args);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Arena */
+
+int fc_arena_init(fc_arena* arena, void* buffer, size_t size) {
+	memset(arena, 0, sizeof(fc_arena));
+	if (!buffer) {
+		if (!(buffer = malloc(size)))
+			return FC_ERR_NOMEM;
+		arena->owned = 1;
+	}
+	arena->base = (uint8_t*)buffer;
+	arena->size = size;
+	return FC_OK;
+}
+
+static size_t arena_aligned_used(const fc_arena* arena) {
+	return (arena->used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+// Allocated memory is zero-filled
+void* fc_arena_alloc(fc_arena* arena, size_t size) {
+	size_t offset = arena_aligned_used(arena);
+	if (offset > arena->size || arena->size - offset < size)
+		return 0;
+	arena->used = offset + size;
+	memset(arena->base + offset, 0, size);
+	return arena->base + offset;
+}
+
+void fc_arena_reset(fc_arena* arena) {
+	arena->used = 0;
+}
+
+void fc_arena_free(fc_arena* arena) {
+	if (arena->owned && arena->base)
+		free(arena->base);
+	memset(arena, 0, sizeof(fc_arena));
+}
+
+static char* arena_strdup(fc_arena* arena, const char* str) {
+	size_t len = strlen(str);
+	char* res = (char*)fc_arena_alloc(arena, len + 1);
+	if (res)
+		memcpy(res, str, len + 1);
+	return res;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Options & ranges */
+
+void fc_options_init(fc_options* opts) {
+	memset(opts, 0, sizeof(fc_options));
+	opts->dpi = 96;
+	opts->hinting = FC_HINTING_MONO;
+	// Unless overridden, default first and last chars are
+	// ' ' (space) and '~', respectively
+	opts->ranges[0].first = 0x20;		// ' ' SPACE
+	opts->ranges[0].last = 0x7E;		// '~' TILDE
+	opts->rangesCount = 1;
+}
+
+int fc_atoi(const char* str) {
+	if (!str || !str[0])
+		return -1;
+	size_t len = strlen(str);
+	char* strcp = 0;
+	int res = 0;
+	char* endptr = 0;
+	if (len > 1 && str[len - 1] == 'h') {
+		strcp = strdup(str);
+		strcp[len - 1] = 0;
+		res = strtol(strcp, &endptr, 16);
+	} else
+		res = strtol(str, &endptr, 0);
+	if (*endptr != 0)
+		res = -1;
+	if (strcp)
+		free(strcp);
+	return res;
+}
+
+int fc_parse_ranges(GFXglyphRange* ranges, const char* str, int max_sz) {
+	int res = -1;
+	const char* ptr = str;
+	int i = 0;
+	uint16_t first = 0;
+	uint16_t last = 0;
+	char number_str[MAX_NUMBER_STR_SZ];
+	char* number_str_ins_ptr = number_str;
+	int have_errors = 0;
+	while (1) {
+		if (*ptr == '-') {
+			first = (uint16_t)fc_atoi(number_str);
+			if (first == (uint16_t)-1) {
+				have_errors = 1;
+				break;
+			}
+			// prepare for next number
+			number_str_ins_ptr = number_str;
+		} else if (*ptr == ',' || *ptr == ';' || *ptr == 0) {
+			last = fc_atoi(number_str);
+			if (last == (uint16_t)-1) {
+				have_errors = 1;
+				break;
+			}
+			if (last < first) {
+				have_errors = 1;
+				break;
+			}
+			if (0 == first)
+				first = last;
+			ranges[i].first = first;
+			ranges[i].last = last;
+			// prepare for next number pair
+			i++;
+			first = 0;
+			last = 0;
+			number_str_ins_ptr = number_str;
+		} else {
+			if (number_str_ins_ptr - number_str < MAX_NUMBER_STR_SZ - 1) {
+				*number_str_ins_ptr = *ptr;
+				number_str_ins_ptr++;
+				*number_str_ins_ptr = 0;
+			} else {
+				have_errors = 1;
+				break;
+			}
+		}
+		if (i >= max_sz)
+			break;
+		if (*ptr == 0)
+			break;
+		ptr++;
+	}
+	if (!have_errors)
+		res = i;
+	return res;
+}
+
+static int range_comparator(const void * n1, const void * n2) {
+	GFXglyphRange* r1 = (GFXglyphRange*)n1;
+	GFXglyphRange* r2 = (GFXglyphRange*)n2;
+	if (r1->first > r2->first)
+		return 1;
+	else if (r1->first < r2->first)
+		return -1;
+	int r1_sz = r1->last - r1->first + 1;
+	int r2_sz = r2->last - r2->first + 1;
+	return r1_sz == r2_sz ? 0 : (r1_sz > r2_sz ? 1 : -1);
+}
+
+int fc_normalize_ranges(GFXglyphRange* ranges, int* count) {
+	int i, j;
+	int ranges_count = *count;
+	// Sort character set ranges
+	qsort(ranges, (size_t)ranges_count, sizeof(GFXglyphRange), range_comparator);
+	// validate ranges: check duplicates and/or interceptions
+	for (i = 1; i < ranges_count; i++) {
+		if (ranges[i].first >= ranges[i - 1].first && ranges[i].first <= ranges[i - 1].last)
+			return FC_ERR_ARGS;
+		else if (ranges[i].last < ranges[i - 1].last)
+			return FC_ERR_ARGS;
+	}
+	// Combine consecutive ranges
+	for (i = ranges_count - 1; i > 0; i--) {
+		if (ranges[i].first == ranges[i - 1].last + 1) {
+			ranges[i - 1].last = ranges[i].last;
+			for (j = i; j < ranges_count - 1; j++)
+				memcpy(&ranges[j], &ranges[j + 1], sizeof(GFXglyphRange));
+			ranges_count--;
+		}
+	}
+	*count = ranges_count;
+	return FC_OK;
+}
+
+static int chars_count_of(const fc_options* opts) {
+	int i;
+	int count = 0;
+	for (i = 0; i < opts->rangesCount; i++)
+		count += opts->ranges[i].last - opts->ranges[i].first + 1;
+	return count;
+}
+
+size_t fc_arena_size_hint(const fc_options* opts) {
+	size_t chars_count = (size_t)chars_count_of(opts);
+	size_t name_len = opts->fontName ? strlen(opts->fontName) : (opts->filePath ? strlen(opts->filePath) : 0);
+	// Relocated bitmap is a second copy when layout manifest is used
+	return chars_count * (sizeof(GFXglyph) + sizeof(char*) + sizeof(uint16_t) + FC_MAX_GLYPH_NAME_LEN) +
+		FC_MAX_RANGES * sizeof(GFXglyphRange) + name_len + 28 + FC_MAX_GLYPH_NAME_LEN * 2 +
+		(opts->prevLayout ? 2 : 1) * FC_MAX_BITMAP_SIZE + 16 * ARENA_ALIGN;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Conversion */
+
+static int init_library(FT_Library* library, const fc_options* opts) {
+	int err;
+	if ((err = FT_Init_FreeType(library))) {
+		fc_log(opts, "FreeType init error: %d\n", err);
+		return err;
+	}
+
+	// Use TrueType engine version 35, without subpixel rendering.
+	// This improves clarity of fonts since this library does not
+	// support rendering multiple levels of gray in a glyph.
+	// See https://github.com/adafruit/Adafruit-GFX-Library/issues/103
+	FT_UInt interpreter_version = TT_INTERPRETER_VERSION_35;
+	FT_Property_Set(*library, "truetype", "interpreter-version",
+					&interpreter_version);
+	return 0;
+}
+
+fc_context* fc_context_new(void) {
+	fc_context* ctx = (fc_context*)calloc(1, sizeof(fc_context));
+	fc_options opts;
+	if (!ctx)
+		return 0;
+	fc_options_init(&opts);
+	if (init_library(&ctx->library, &opts)) {
+		free(ctx);
+		return 0;
+	}
+	return ctx;
+}
+
+static void flush_face_cache(fc_context* ctx) {
+	int i;
+	for (i = 0; i < ctx->facesCapacity; i++) {
+		if (ctx->faces[i].face) {
+			FT_Done_Face(ctx->faces[i].face);
+			free(ctx->faces[i].path);
+		}
+	}
+	free(ctx->faces);
+	ctx->faces = 0;
+	ctx->facesCapacity = 0;
+}
+
+void fc_context_free(fc_context* ctx) {
+	if (!ctx)
+		return;
+	flush_face_cache(ctx);
+	FT_Done_FreeType(ctx->library);
+	free(ctx);
+}
+
+int fc_context_set_cache_size(fc_context* ctx, int count) {
+	flush_face_cache(ctx);
+	if (count <= 0)
+		return FC_OK;
+	if (!(ctx->faces = (face_cache_entry*)calloc(count, sizeof(face_cache_entry))))
+		return FC_ERR_NOMEM;
+	ctx->facesCapacity = count;
+	return FC_OK;
+}
+
+// Open face, reusing cached one if the file is not changed since
+static int acquire_face(FT_Library library, fc_context* ctx, const char* filePath, FT_Face* face) {
+	struct stat st;
+	face_cache_entry* entry;
+	int i;
+	int err;
+	if (!ctx || !ctx->facesCapacity || stat(filePath, &st) != 0)
+		return FT_New_Face(library, filePath, 0, face);
+	entry = &ctx->faces[0];
+	for (i = 0; i < ctx->facesCapacity; i++) {
+		face_cache_entry* e = &ctx->faces[i];
+		if (e->face && strcmp(e->path, filePath) == 0) {
+			if (e->dev == st.st_dev && e->ino == st.st_ino && e->fileSize == st.st_size &&
+				e->mtime == st.st_mtime && e->mtimeNsec == (long)STAT_MTIME_NSEC(st)) {
+				e->lastUse = ++ctx->useCounter;
+				*face = e->face;
+				return 0;
+			}
+			// File changed, replace stale entry
+			entry = e;
+			break;
+		}
+		// Prefer empty slot, then least recently used one
+		if (entry->face && (!e->face || e->lastUse < entry->lastUse))
+			entry = e;
+	}
+	if ((err = FT_New_Face(library, filePath, 0, face)))
+		return err;
+	char* path = strdup(filePath);
+	if (!path)
+		return 0;	// keep face uncached
+	if (entry->face) {
+		FT_Done_Face(entry->face);
+		free(entry->path);
+	}
+	entry->path = path;
+	entry->dev = st.st_dev;
+	entry->ino = st.st_ino;
+	entry->mtime = st.st_mtime;
+	entry->mtimeNsec = (long)STAT_MTIME_NSEC(st);
+	entry->fileSize = st.st_size;
+	entry->face = *face;
+	entry->lastUse = ++ctx->useCounter;
+	return 0;
+}
+
+static void release_face(fc_context* ctx, FT_Face face) {
+	int i;
+	if (ctx) {
+		for (i = 0; i < ctx->facesCapacity; i++) {
+			if (ctx->faces[i].face == face)
+				return;
+		}
+	}
+	FT_Done_Face(face);
+}
+
+// Derive font table names from filename.  Period (filename
+// extension) is truncated and replaced with the font size & bits.
+static char* derive_font_name(fc_arena* arena, const fc_options* opts) {
+	const char* ptr;
+	char* fontName;
+	char* ext;
+	char c;
+	int i;
+
+	ptr = strrchr(opts->filePath, '/'); // Find last slash in filename
+	if (ptr)
+		ptr++; // First character of filename (path stripped)
+	else
+		ptr = opts->filePath; // No path; font in local dir.
+
+	if (!(fontName = (char*)fc_arena_alloc(arena, strlen(ptr) + 28)))
+		return 0;
+	strcpy(fontName, ptr);
+	ext = strrchr(fontName, '.'); // Find last period (file ext)
+	if (!ext)
+		ext = &fontName[strlen(fontName)]; // If none, append
+	if (1 == opts->rangesCount) {
+		// Insert font size.  fontName was alloc'd w/extra
+		// space to allow this, we're not sprintfing into Forbidden Zone.
+		if (opts->ranges[0].first == opts->ranges[0].last)
+			sprintf(ext, "%dpt_char%02X", opts->size, opts->ranges[0].first);
+		else if (opts->ranges[0].first == 0x20 && opts->ranges[0].last == 0x7E)
+			sprintf(ext, "%dpt_ascii", opts->size);
+		else
+			sprintf(ext, "%dpt_%02X_%02X", opts->size, opts->ranges[0].first, opts->ranges[0].last);
+	}
+	else
+	{
+		sprintf(ext, "%dpt_mixed", opts->size);
+	}
+	// Space and punctuation chars in name replaced w/ underscores.
+	for (i = 0; (c = fontName[i]); i++) {
+		if (isspace(c) || ispunct(c))
+			fontName[i] = '_';
+	}
+	return fontName;
+}
+
+// Render all glyphs and fill glyph table & bitmap
+static int render_glyphs(FT_Face face, const fc_options* opts, fc_arena* arena, fc_font* font) {
+	int i, j;
+	int err;
+	int x, y;
+	FT_Int32 load_flags;
+	FT_Glyph glyph;
+	FT_Bitmap *bitmap;
+	FT_BitmapGlyphRec *g;
+	FT_ULong char_;
+	FT_UInt glyph_index;
+	uint32_t bitmapOffset = 0;
+	size_t capacity;
+
+	// MONO renderer provides clean image with perfect crop
+	// (no wasted pixels) via bitmap struct.
+	switch (opts->hinting) {
+		case FC_HINTING_NO:
+			load_flags = FT_LOAD_NO_HINTING;
+			break;
+		case FC_HINTING_MONO:
+			load_flags = FT_LOAD_TARGET_MONO;
+			break;
+		case FC_HINTING_AUTO:
+			load_flags = FT_LOAD_TARGET_MONO | FT_LOAD_FORCE_AUTOHINT;
+			break;
+		default:
+			load_flags = FT_LOAD_TARGET_MONO;
+			break;
+	}
+
+	// Bitmap occupies the rest of arena, unused tail is released at the end
+	font->bitmap = (uint8_t*)fc_arena_alloc(arena, 0);
+	if (!font->bitmap)
+		return FC_ERR_NOMEM;
+	capacity = arena->size - arena->used;
+
+	j = 0;
+	for (i = 0; i < opts->rangesCount; i++) {
+		for (char_ = opts->ranges[i].first; char_ <= opts->ranges[i].last; char_++, j++) {
+			if ((glyph_index = FT_Get_Char_Index(face, char_)) == 0) {
+				fc_log(opts, "undefined character code 0x%04X\n", (unsigned int)char_);
+				continue;
+			}
+
+			if ((err = FT_Load_Glyph(face, glyph_index, load_flags))) {
+				fc_log(opts, "Error %d loading char '0x%04X'\n", err, (unsigned int)char_);
+				font->ftError = err;
+				continue;
+			}
+
+			if ((err = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_MONO))) {
+				fc_log(opts, "Error %d rendering char '0x%04X'\n", err, (unsigned int)char_);
+				font->ftError = err;
+				continue;
+			}
+
+			if ((err = FT_Get_Glyph(face->glyph, &glyph))) {
+				fc_log(opts, "Error %d getting glyph '0x%04X'\n", err, (unsigned int)char_);
+				font->ftError = err;
+				continue;
+			}
+
+			bitmap = &face->glyph->bitmap;
+			g = (FT_BitmapGlyphRec *)glyph;
+
+			// Minimal font and per-glyph information is stored to
+			// reduce flash space requirements.  Glyph bitmaps are
+			// fully bit-packed; no per-scanline pad, though end of
+			// each character may be padded to next byte boundary
+			// when needed.  16-bit offset means 64K max for bitmaps.
+			// (Doesn't check that size & offsets are within bounds
+			// either for that matter...please convert fonts responsibly.)
+			uint32_t glyphSize = (bitmap->width * bitmap->rows + 7) / 8;
+			if (bitmapOffset + glyphSize > FC_MAX_BITMAP_SIZE) {
+				fc_log(opts, "Bitmap data exceeds 64K at char '0x%04X'\n", (unsigned int)char_);
+				FT_Done_Glyph(glyph);
+				return FC_ERR_OVERFLOW;
+			}
+			if (bitmapOffset + glyphSize > capacity) {
+				FT_Done_Glyph(glyph);
+				return FC_ERR_NOMEM;
+			}
+			font->glyphs[j].bitmapOffset = bitmapOffset;
+			font->slotSizes[j] = glyphSize;
+			font->glyphs[j].width = bitmap->width;
+			font->glyphs[j].height = bitmap->rows;
+			font->glyphs[j].xAdvance = face->glyph->advance.x >> 6;
+			font->glyphs[j].xOffset = g->left;
+			font->glyphs[j].yOffset = 1 - g->top;
+
+			// Rows are concatenated without padding, end of char bitmap
+			// is padded to next byte boundary.
+			uint8_t* dst = font->bitmap + bitmapOffset;
+			uint32_t pos = 0;
+			memset(dst, 0, glyphSize);
+			for (y = 0; y < (int)bitmap->rows; y++) {
+				for (x = 0; x < (int)bitmap->width; x++, pos++) {
+					if (bitmap->buffer[y * bitmap->pitch + x / 8] & (0x80 >> (x & 7)))
+						dst[pos >> 3] |= 0x80 >> (pos & 7);
+				}
+			}
+			bitmapOffset += glyphSize;
+
+			FT_Done_Glyph(glyph);
+		}
+	}
+	arena->used += bitmapOffset;
+	font->bitmapSize = bitmapOffset;
+	return FC_OK;
+}
+
+int fc_convert(fc_context* ctx, const fc_options* opts, fc_arena* arena, fc_font* font) {
+	int i, j;
+	int err;
+	int res = FC_OK;
+	FT_Library library;
+	FT_Face face;
+	FT_ULong char_;
+	GFXglyphRange* ranges;
+	char glyphName[FC_MAX_GLYPH_NAME_LEN] = { 0 };
+
+	memset(font, 0, sizeof(fc_font));
+	if (!opts->filePath || !opts->filePath[0] || opts->size <= 0 || opts->dpi <= 0 ||
+		opts->rangesCount <= 0 || opts->rangesCount > FC_MAX_RANGES)
+		return FC_ERR_ARGS;
+
+	font->filePath = opts->filePath;
+	font->size = opts->size;
+	font->dpi = opts->dpi;
+	font->hinting = opts->hinting;
+	font->rangesCount = opts->rangesCount;
+	font->charsCount = chars_count_of(opts);
+
+	// Allocate space for font name, ranges and glyph table
+	if (!(font->fontName = opts->fontName ? arena_strdup(arena, opts->fontName) : derive_font_name(arena, opts)) ||
+		!(ranges = (GFXglyphRange*)fc_arena_alloc(arena, opts->rangesCount * sizeof(GFXglyphRange))) ||
+		!(font->glyphs = (GFXglyph*)fc_arena_alloc(arena, font->charsCount * sizeof(GFXglyph))) ||
+		!(font->glyphNames = (const char**)fc_arena_alloc(arena, font->charsCount * sizeof(char*))) ||
+		!(font->slotSizes = (uint16_t*)fc_arena_alloc(arena, font->charsCount * sizeof(uint16_t))))
+		return FC_ERR_NOMEM;
+	memcpy(ranges, opts->ranges, opts->rangesCount * sizeof(GFXglyphRange));
+	font->ranges = ranges;
+
+	// Init FreeType lib, load font
+	if (ctx)
+		library = ctx->library;
+	else if ((err = init_library(&library, opts))) {
+		font->ftError = err;
+		return FC_ERR_FREETYPE;
+	}
+
+	if ((err = acquire_face(library, ctx, opts->filePath, &face))) {
+		fc_log(opts, "Font load error: %d\n", err);
+		font->ftError = err;
+		res = FC_ERR_FREETYPE;
+		goto done_library;
+	}
+
+	// << 6 because '26dot6' fixed-point format
+	if ((err = FT_Set_Char_Size(face, opts->size << 6, 0, opts->dpi, 0))) {
+		fc_log(opts, "Set font char size error: %d\n", err);
+		font->ftError = err;
+		res = FC_ERR_FREETYPE;
+		goto done_face;
+	}
+
+	// Always use unicode charmap
+	if ((err = FT_Select_Charmap(face, FT_ENCODING_UNICODE))) {
+		fc_log(opts, "Select unicode charmap error: %d\n", err);
+		font->ftError = err;
+		res = FC_ERR_FREETYPE;
+		goto done_face;
+	}
+
+	if (!(font->familyName = arena_strdup(arena, face->family_name ? face->family_name : ""))) {
+		res = FC_ERR_NOMEM;
+		goto done_face;
+	}
+
+	// Currently all symbols from 'first' to 'last' in all character set ranges are processed.
+	// Fonts may contain WAY more glyphs than that, but this code
+	// will need to handle encoding stuff to deal with extracting
+	// the right symbols, and that's not done yet.
+	j = 0;
+	for (i = 0; i < opts->rangesCount; i++) {
+		for (char_ = opts->ranges[i].first; char_ <= opts->ranges[i].last; char_++, j++) {
+			if (FT_Get_Glyph_Name(face, FT_Get_Char_Index(face, char_), glyphName, FC_MAX_GLYPH_NAME_LEN) == 0)
+				glyphName[FC_MAX_GLYPH_NAME_LEN - 1] = 0;
+			else
+				glyphName[0] = 0;
+			if (!(font->glyphNames[j] = arena_strdup(arena, glyphName))) {
+				res = FC_ERR_NOMEM;
+				goto done_face;
+			}
+		}
+	}
+
+	if ((res = render_glyphs(face, opts, arena, font)) != FC_OK)
+		goto done_face;
+
+	if (opts->prevLayout && (res = fc_layout_apply(opts->prevLayout, font, arena)) != FC_OK) {
+		if (res == FC_ERR_OVERFLOW)
+			fc_log(opts, "Bitmap data exceeds 64K after layout placement, start a fresh layout without previous manifest\n");
+		goto done_face;
+	}
+
+	if (face->size->metrics.height == 0) {
+		// No face height info, assume fixed width and get from a glyph.
+		font->yAdvance = font->glyphs[0].height;
+	} else {
+		font->yAdvance = (int)(face->size->metrics.height >> 6);
+	}
+
+done_face:
+	release_face(ctx, face);
+done_library:
+	if (!ctx)
+		FT_Done_FreeType(library);
+	return res;
+}
+
+const char* fc_strerror(int err) {
+	switch (err) {
+		case FC_OK:
+			return "success";
+		case FC_ERR_ARGS:
+			return "invalid options";
+		case FC_ERR_NOMEM:
+			return "out of memory";
+		case FC_ERR_FREETYPE:
+			return "FreeType error";
+		case FC_ERR_OVERFLOW:
+			return "bitmap data exceeds 64K";
+		case FC_ERR_IO:
+			return "output error";
+		case FC_ERR_LAYOUT:
+			return "invalid layout manifest";
+		default:
+			return "unknown error";
+	}
+}
+
+/* ---------------------------------------------------------------------- */
+/* Compact glyph table */
+
+// Count of bits required to store unsigned value
+static uint8_t bits_for(uint32_t value) {
+	uint8_t bits = 0;
+	while (value) {
+		bits++;
+		value >>= 1;
+	}
+	return bits;
+}
+
+/**
+ * @brief Calculate minimal packed glyph record layout for glyph table
+ * @param layout destination layout
+ * @param table glyph table
+ * @param count count of records in glyph table
+ */
+void fc_calc_compact_layout(GFXglyphLayout* layout, const GFXglyph* table, int count) {
+	uint16_t maxOffset = 0;
+	uint8_t maxWidth = 0, maxHeight = 0, maxXAdvance = 0;
+	int8_t minXOffset = 0, maxXOffset = 0, minYOffset = 0, maxYOffset = 0;
+	int i;
+	for (i = 0; i < count; i++) {
+		if (table[i].bitmapOffset > maxOffset)
+			maxOffset = table[i].bitmapOffset;
+		if (table[i].width > maxWidth)
+			maxWidth = table[i].width;
+		if (table[i].height > maxHeight)
+			maxHeight = table[i].height;
+		if (table[i].xAdvance > maxXAdvance)
+			maxXAdvance = table[i].xAdvance;
+		if (0 == i || table[i].xOffset < minXOffset)
+			minXOffset = table[i].xOffset;
+		if (0 == i || table[i].xOffset > maxXOffset)
+			maxXOffset = table[i].xOffset;
+		if (0 == i || table[i].yOffset < minYOffset)
+			minYOffset = table[i].yOffset;
+		if (0 == i || table[i].yOffset > maxYOffset)
+			maxYOffset = table[i].yOffset;
+	}
+	layout->offsetBits = bits_for(maxOffset);
+	layout->widthBits = bits_for(maxWidth);
+	layout->heightBits = bits_for(maxHeight);
+	layout->xAdvanceBits = bits_for(maxXAdvance);
+	layout->xOffsetBits = bits_for((uint32_t)(maxXOffset - minXOffset));
+	layout->yOffsetBits = bits_for((uint32_t)(maxYOffset - minYOffset));
+	layout->xOffsetBias = minXOffset;
+	layout->yOffsetBias = minYOffset;
+	int totalBits = layout->offsetBits + layout->widthBits + layout->heightBits +
+			layout->xAdvanceBits + layout->xOffsetBits + layout->yOffsetBits;
+	layout->recordSize = (uint8_t)((totalBits + 7) / 8);
+	if (0 == layout->recordSize)
+		layout->recordSize = 1;
+}
+
+// Pack glyph metrics into little-endian record using specified layout
+void fc_pack_compact_glyph(uint8_t* record, const GFXglyph* glyph, const GFXglyphLayout* layout) {
+	uint64_t rec = 0;
+	uint8_t shift = 0;
+	uint8_t i;
+	rec |= (uint64_t)glyph->bitmapOffset << shift;
+	shift += layout->offsetBits;
+	rec |= (uint64_t)glyph->width << shift;
+	shift += layout->widthBits;
+	rec |= (uint64_t)glyph->height << shift;
+	shift += layout->heightBits;
+	rec |= (uint64_t)glyph->xAdvance << shift;
+	shift += layout->xAdvanceBits;
+	rec |= (uint64_t)(uint8_t)(glyph->xOffset - layout->xOffsetBias) << shift;
+	shift += layout->xOffsetBits;
+	rec |= (uint64_t)(uint8_t)(glyph->yOffset - layout->yOffsetBias) << shift;
+	for (i = 0; i < layout->recordSize; i++) {
+		record[i] = (uint8_t)(rec & 0xFF);
+		rec >>= 8;
+	}
+}
+
+// Check if ranges of the font can be stored as 16-bit pairs
+int fc_ranges16(const fc_font* font) {
+	return font->ranges[font->rangesCount - 1].last <= 0xFFFF;
+}
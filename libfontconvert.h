@@ -0,0 +1,315 @@
+/*
+TrueType to Adafruit_GFX font converter library.
+
+Embeddable C API of the fontconvert utility: font conversion is performed
+in memory by fc_convert(), result is written by one of the emitters into
+an output sink (FILE stream or memory buffer).
+
+Typical usage:
+  fc_options opts;
+  fc_arena arena;
+  fc_font font;
+  fc_sink out;
+  fc_options_init(&opts);
+  opts.filePath = "FreeSans.ttf";
+  opts.size = 18;
+  fc_arena_init(&arena, NULL, fc_arena_size_hint(&opts));
+  if (fc_convert(NULL, &opts, &arena, &font) == FC_OK) {
+    fc_sink_init_file(&out, stdout);
+    fc_emit(&fc_emitter_header, &font, &opts, &out);
+  }
+  fc_arena_free(&arena);
+
+REQUIRES FREETYPE LIBRARY.  www.freetype.org
+*/
+
+#ifndef _LIBFONTCONVERT_H_
+#define _LIBFONTCONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gfxfont.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FC_MAX_RANGES			64
+#define FC_MAX_GLYPH_NAME_LEN	128
+#define FC_MAX_BITMAP_SIZE		0xFFFF	// 16-bit bitmap offsets
+
+// Error codes
+#define FC_OK					0
+#define FC_ERR_ARGS				-1	// invalid options
+#define FC_ERR_NOMEM			-2	// out of memory or arena exhausted
+#define FC_ERR_FREETYPE			-3	// FreeType error, see fc_font.ftError
+#define FC_ERR_OVERFLOW			-4	// bitmap data exceeds 64K
+#define FC_ERR_IO				-5	// output error
+#define FC_ERR_LAYOUT			-6	// invalid layout manifest
+
+// Hinting modes
+#define FC_HINTING_NO			0
+#define FC_HINTING_MONO			1
+#define FC_HINTING_AUTO			2
+
+/**
+ * Output sink: FILE stream or memory buffer.
+ * Memory buffer is either caller-provided (fixed capacity)
+ * or allocated by sink and grown as needed.
+ */
+typedef struct fc_sink {
+	FILE*    file;			// destination stream, NULL for memory sink
+	uint8_t* buffer;		// memory buffer
+	size_t   size;			// bytes written to memory buffer
+	size_t   capacity;		// capacity of memory buffer
+	int      owned;			// buffer allocated by sink
+} fc_sink;
+
+void fc_sink_init_file(fc_sink* sink, FILE* file);
+void fc_sink_init_memory(fc_sink* sink, void* buffer, size_t capacity);
+void fc_sink_reset(fc_sink* sink);
+void fc_sink_free(fc_sink* sink);
+int fc_sink_write(fc_sink* sink, const void* data, size_t size);
+int fc_sink_printf(fc_sink* sink, const char* format, ...)
+#ifdef __GNUC__
+	__attribute__((format(printf, 2, 3)))
+#endif
+	;
+
+/**
+ * Bump allocator holding all data of converted font.
+ * Memory is caller-provided or allocated once by fc_arena_init();
+ * fc_arena_reset() makes it reusable for the next conversion.
+ */
+typedef struct {
+	uint8_t* base;
+	size_t   size;
+	size_t   used;
+	int      owned;
+} fc_arena;
+
+int fc_arena_init(fc_arena* arena, void* buffer, size_t size);
+void* fc_arena_alloc(fc_arena* arena, size_t size);
+void fc_arena_reset(fc_arena* arena);
+void fc_arena_free(fc_arena* arena);
+
+struct fc_layout;
+
+typedef struct {
+	const char* filePath;			// path to the font file
+	const char* fontName;			// C identifier of the font, NULL to derive from filePath
+	int size;						// font size in points
+	int dpi;
+	int hinting;					// FC_HINTING_*
+	GFXglyphRange ranges[FC_MAX_RANGES];	// characters set ranges, sorted and combined
+	int rangesCount;
+	int progmem;					// emitter: use 'PROGMEM' specification
+	int compact;					// emitter: bit-packed glyph table (GFXfontCompact)
+	fc_sink* log;					// diagnostic messages, may be NULL
+	const struct fc_layout* prevLayout;	// keep bitmap placement of previous build, may be NULL
+} fc_options;
+
+// Converted font, all data is allocated in arena
+typedef struct {
+	const char* fontName;
+	const char* familyName;
+	const char* filePath;
+	int size;
+	int dpi;
+	int hinting;
+	const GFXglyphRange* ranges;
+	int rangesCount;
+	GFXglyph* glyphs;				// glyph table, one record per character
+	const char** glyphNames;		// glyph names, empty string if unknown
+	int charsCount;
+	uint8_t* bitmap;				// glyph bitmaps, concatenated
+	uint32_t bitmapSize;
+	uint16_t* slotSizes;			// bitmap space reserved per glyph
+	int yAdvance;					// newline distance in pixels
+	int ftError;					// last FreeType error code
+} fc_font;
+
+// Conversion context: FreeType library instance reusable between conversions
+// and optional LRU cache of opened faces
+typedef struct fc_context fc_context;
+
+fc_context* fc_context_new(void);
+void fc_context_free(fc_context* ctx);
+
+// Keep up to 'count' recently used faces opened, 0 disables the cache.
+// Cached face is reopened when its file is replaced or its size or
+// modification time (with nanoseconds) changes.
+int fc_context_set_cache_size(fc_context* ctx, int count);
+
+void fc_options_init(fc_options* opts);
+
+// Parse number in C notation or hexadecimal with 'h' suffix, -1 on error
+int fc_atoi(const char* str);
+
+/**
+ * @brief Parse string as ranges list into GFXglyphRange array
+ * @param ranges destination array of ranges
+ * @param str insput string
+ * @param max_sz capacity of destination array
+ * @return count of records if parsed successfully, -1 otherwise.
+ *
+ * Example of strings that can be used:
+ *   0x20-0x7E,0xA9,0xAE
+ *   20h-7Eh,A9h,AEh
+ *   0x20-0x7E,0x401,0x410-0x44F,0x451,0xA9,0xAE
+ */
+int fc_parse_ranges(GFXglyphRange* ranges, const char* str, int max_sz);
+
+/**
+ * @brief Sort ranges, validate them and combine consecutive ones
+ * @param ranges array of ranges
+ * @param count pointer to count of ranges, updated after combining
+ * @return FC_OK or FC_ERR_ARGS if ranges contain duplicates or interceptions.
+ */
+int fc_normalize_ranges(GFXglyphRange* ranges, int* count);
+
+// Upper bound of arena size required to convert font with these options
+size_t fc_arena_size_hint(const fc_options* opts);
+
+/**
+ * @brief Convert font using specified options
+ * @param ctx conversion context, NULL to use temporary one
+ * @param opts conversion options
+ * @param arena arena to allocate font data in
+ * @param font destination font
+ * @return FC_OK on success, FC_ERR_* otherwise.
+ */
+int fc_convert(fc_context* ctx, const fc_options* opts, fc_arena* arena, fc_font* font);
+
+const char* fc_strerror(int err);
+
+// Compact glyph table helpers
+void fc_calc_compact_layout(GFXglyphLayout* layout, const GFXglyph* table, int count);
+void fc_pack_compact_glyph(uint8_t* record, const GFXglyph* glyph, const GFXglyphLayout* layout);
+int fc_ranges16(const fc_font* font);
+
+/**
+ * Output format emitter. Custom emitters can be passed to fc_emit() as well.
+ */
+typedef struct {
+	const char* name;
+	int (*emit)(const fc_font* font, const fc_options* opts, fc_sink* out);
+} fc_emitter;
+
+// C header with font data declarations (Adafruit_GFX style)
+extern const fc_emitter fc_emitter_header;
+
+/*
+ Binary font blob, all values little-endian:
+   0  4  magic "GFXF"
+   4  1  version, FC_BINARY_VERSION
+   5  1  flags, FC_BINARY_COMPACT | FC_BINARY_RANGES16
+   6  2  ranges count
+   8  2  characters count
+  10  1  newline distance in pixels
+  11  1  glyph record size in bytes
+  12  4  bitmap size
+  16  9  GFXglyphLayout (compact glyph table only, zeros otherwise)
+  25  7  reserved (zeros)
+  32     ranges: uint16 or uint32 first/last pairs
+         glyph records: GFXglyph fields (uint16 bitmapOffset, uint8 width,
+                        height, xAdvance, int8 xOffset, yOffset)
+                        or compact packed records
+         bitmap
+*/
+#define FC_BINARY_VERSION		1
+#define FC_BINARY_HEADER_SIZE	32
+#define FC_BINARY_COMPACT		0x01
+#define FC_BINARY_RANGES16		0x02
+
+// Sections of binary font blob
+#define FC_SECTION_HEADER		0
+#define FC_SECTION_RANGES		1
+#define FC_SECTION_GLYPHS		2
+#define FC_SECTION_BITMAP		3
+#define FC_SECTIONS_COUNT		4
+
+extern const fc_emitter fc_emitter_binary;
+
+// Write one section of binary font blob
+int fc_binary_section(const fc_font* font, int compact, int section, fc_sink* out);
+
+// Find builtin emitter by name ("header", "binary"), NULL if not found
+const fc_emitter* fc_find_emitter(const char* name);
+
+int fc_emit(const fc_emitter* emitter, const fc_font* font, const fc_options* opts, fc_sink* out);
+
+/**
+ * Layout manifest of a build: placement and checksum of every glyph bitmap.
+ * Passed as fc_options.prevLayout to the next conversion, glyphs present in
+ * previous build keep their bitmap offsets while they fit into their slots,
+ * new or grown glyphs are placed first-fit into space freed by removed or
+ * grown glyphs, then after the last kept slot; free space at the end of
+ * bitmap is trimmed.
+ * If fragmented bitmap exceeds 64K, fc_convert() fails with FC_ERR_OVERFLOW:
+ * start a fresh layout by converting without prevLayout (no --layout) and
+ * ship the full binary blob instead of a patch.
+ *
+ * Text format:
+ *   font <bitmap_size> <y_advance> <compact>
+ *   range <first> <last>
+ *   glyph <code> <offset> <slot> <width> <height> <x_advance> <x_offset> <y_offset> <crc32>
+ * one 'glyph' line per character in glyph table order.
+ * fc_layout_read() rejects manifest (FC_ERR_LAYOUT) if ranges are not ascending,
+ * glyphs do not match ranges, or any slot is smaller than its glyph bitmap,
+ * exceeds bitmap size or overlaps another one.
+ */
+typedef struct fc_layout {
+	GFXglyphRange ranges[FC_MAX_RANGES];
+	int rangesCount;
+	int charsCount;
+	int yAdvance;
+	int compact;
+	uint32_t bitmapSize;
+	uint32_t* codepoints;			// ascending
+	GFXglyph* glyphs;
+	uint16_t* slotSizes;
+	uint32_t* crcs;					// CRC-32 of glyph bitmaps
+} fc_layout;
+
+int fc_layout_read(fc_layout* layout, FILE* file);
+int fc_layout_write(const fc_font* font, const fc_options* opts, fc_sink* out);
+void fc_layout_free(fc_layout* layout);
+
+// Index of character in layout glyph table, -1 if not found
+int fc_layout_find(const fc_layout* layout, uint32_t code);
+
+// Move glyph bitmaps of converted font to their places in layout (used by fc_convert)
+int fc_layout_apply(const fc_layout* layout, fc_font* font, fc_arena* arena);
+
+/*
+ Binary patch from previous build (layout manifest) to the converted font,
+ sections of binary font blob are patched independently.
+ All values little-endian:
+   0  4  magic "GFXP"
+   4  1  version, FC_PATCH_VERSION
+   5  3  reserved (zeros)
+   8 16  new size of each section, uint32 * FC_SECTIONS_COUNT
+  24  4  regions count
+  28     regions: uint8 section, uint32 offset, uint32 length, data
+ Section is truncated or zero-extended to its new size before applying regions.
+*/
+#define FC_PATCH_VERSION		1
+
+/**
+ * @brief Write binary patch of changed glyphs and table regions
+ * @param prev layout manifest of previous build
+ * @param font converted font, placed using the same manifest
+ * @param opts conversion options
+ * @param out destination sink
+ * @return FC_OK on success, FC_ERR_* otherwise.
+ */
+int fc_make_patch(const fc_layout* prev, const fc_font* font, const fc_options* opts, fc_sink* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LIBFONTCONVERT_H_
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Round-trip check of fontconvert binary patches (GFXP, see libfontconvert.h).
+
+Converts a chain of builds, each one placed using layout manifest of the
+previous build, applies every patch to the previous binary blob and checks
+that the result is identical to '--format=binary' output of the new build.
+Also checks that a manifest with overlapping slots is rejected.
+
+Usage: patch_roundtrip.py <fontconvert> <font.ttf>
+"""
+
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+HEADER_SIZE = 32
+SECTIONS_COUNT = 4
+BINARY_RANGES16 = 0x02
+
+# Builds of the chain: character set changes, glyphs grow and shrink,
+# glyph table switches between plain and compact
+BUILDS = [
+	["--size=9", "--chars=0x20-0x7E"],
+	["--size=9", "--chars=0x30-0x39"],
+	["--size=9", "--chars=0x20-0x7E,0xA0-0xFF"],
+	["--size=11", "--chars=0x20-0x5F,0xA0-0xFF", "--compact"],
+	["--size=10", "--chars=0x20-0x7E", "--compact"],
+	["--size=9", "--chars=0x20-0x7E"],
+]
+
+
+def split_sections(blob):
+	"""Split binary font blob into header, ranges, glyphs and bitmap."""
+	assert blob[:4] == b"GFXF", "not a binary font blob"
+	flags = blob[5]
+	ranges_count, chars_count = struct.unpack_from("<HH", blob, 6)
+	record_size = blob[11]
+	ranges_end = HEADER_SIZE + ranges_count * (4 if flags & BINARY_RANGES16 else 8)
+	glyphs_end = ranges_end + chars_count * record_size
+	return [blob[:HEADER_SIZE], blob[HEADER_SIZE:ranges_end], blob[ranges_end:glyphs_end], blob[glyphs_end:]]
+
+
+def apply_patch(blob, patch):
+	"""Apply GFXP patch to binary font blob, returns the new blob."""
+	assert patch[:4] == b"GFXP", "not a patch"
+	sizes = struct.unpack_from("<%dI" % SECTIONS_COUNT, patch, 8)
+	regions_count, = struct.unpack_from("<I", patch, 24)
+	sections = []
+	for data, size in zip(split_sections(blob), sizes):
+		section = bytearray(data[:size])
+		section.extend(bytes(size - len(section)))
+		sections.append(section)
+	pos = 28
+	for _ in range(regions_count):
+		section, offset, length = struct.unpack_from("<BII", patch, pos)
+		pos += 9
+		assert offset + length <= len(sections[section]), "region out of section"
+		sections[section][offset:offset + length] = patch[pos:pos + length]
+		pos += length
+	assert pos == len(patch), "trailing data in patch"
+	return b"".join(sections)
+
+
+def convert(fontconvert, font, args):
+	res = subprocess.run([fontconvert, "--format=binary"] + args + [font],
+						 stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+	if res.returncode != 0:
+		raise RuntimeError("%s: %s" % (" ".join(args), res.stderr.decode()))
+	return res.stdout
+
+
+def read(path):
+	with open(path, "rb") as f:
+		return f.read()
+
+
+def main():
+	if len(sys.argv) != 3:
+		print(__doc__.strip())
+		return 2
+	fontconvert, font = sys.argv[1], sys.argv[2]
+	failed = 0
+
+	with tempfile.TemporaryDirectory() as tmp:
+		layout = os.path.join(tmp, "0.layout")
+		blob = convert(fontconvert, font, BUILDS[0] + ["--layout-out=" + layout])
+		for i, args in enumerate(BUILDS[1:], 1):
+			next_layout = os.path.join(tmp, "%d.layout" % i)
+			patch_path = os.path.join(tmp, "%d.patch" % i)
+			new_blob = convert(fontconvert, font, args + ["--layout=" + layout,
+														  "--layout-out=" + next_layout,
+														  "--patch=" + patch_path])
+			patch = read(patch_path)
+			ok = apply_patch(blob, patch) == new_blob
+			print("%-40s blob %5d  patch %5d  %s" % (" ".join(args), len(new_blob), len(patch),
+													 "OK" if ok else "MISMATCH"))
+			failed += not ok
+			blob, layout = new_blob, next_layout
+
+		# Manifest with two glyphs sharing one slot must be rejected
+		with open(layout) as f:
+			lines = f.read().split("\n")
+		glyphs = [i for i, line in enumerate(lines) if line.startswith("glyph ") and line.split()[3] != "0"]
+		first, second = lines[glyphs[0]].split(), lines[glyphs[1]].split()
+		second[2] = first[2]
+		lines[glyphs[1]] = " ".join(second)
+		bad_layout = os.path.join(tmp, "bad.layout")
+		with open(bad_layout, "w") as f:
+			f.write("\n".join(lines))
+		try:
+			convert(fontconvert, font, BUILDS[-1] + ["--layout=" + bad_layout])
+			print("overlapping slots manifest accepted")
+			failed += 1
+		except RuntimeError:
+			pass
+
+	return 1 if failed else 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())